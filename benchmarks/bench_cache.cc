@@ -0,0 +1,207 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "coredd/cache.hh"
+#include "coredd/direct_cache.hh"
+
+#include "benchmarks/benchmarks.hh"
+
+using namespace coredd;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct context {};
+
+struct operation
+{
+  const std::size_t i_;
+
+  operation(std::size_t i)
+    : i_(i)
+  {}
+
+  std::size_t
+  operator()(context&)
+  const noexcept
+  {
+    return i_ + 1;
+  }
+
+  bool
+  operator==(const operation& op)
+  const noexcept
+  {
+    return i_ == op.i_;
+  }
+};
+
+} // namespace anonymous
+
+namespace std {
+
+template <>
+struct hash<operation>
+{
+  std::size_t
+  operator()(const operation& op)
+  const noexcept
+  {
+    return std::hash<std::size_t>()(op.i_);
+  }
+};
+
+} // namespace std
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+const auto nb_ops = 4000000ul;
+
+/// @brief Operations following a skewed distribution, so most of them are hits.
+std::vector<operation>
+skewed_operations()
+{
+  std::vector<operation> ops;
+  ops.reserve(nb_ops);
+  std::mt19937_64 gen{42};
+  std::geometric_distribution<std::size_t> skewed{0.0005};
+  for (auto i = 0ul; i < nb_ops; ++i)
+  {
+    ops.emplace_back(skewed(gen) + 7000);
+  }
+  return ops;
+}
+
+/// @brief Apply all operations to a cache.
+/// @return The time per operation, in nanoseconds.
+template <typename Cache>
+double
+apply(Cache& c, const std::vector<operation>& ops)
+{
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t sum = 0;
+  for (const auto& op : ops)
+  {
+    sum += c(operation(op));
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  // Don't let the compiler discard the operations.
+  asm volatile("" : : "r"(sum) : "memory");
+  return std::chrono::duration<double, std::nano>(stop - start).count() / ops.size();
+}
+
+} // namespace anonymous
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_cache_insertion_position()
+{
+  // A small cache with a low hit rate, as when the cache is under pressure, gives long chains.
+  std::vector<operation> ops;
+  ops.reserve(nb_ops);
+  std::mt19937_64 gen{42};
+  std::uniform_int_distribution<std::size_t> recent{1, 1000};
+  for (auto i = 0ul; i < nb_ops; ++i)
+  {
+    // About one operation out of 3 has recently been computed.
+    ops.emplace_back( i % 3 == 0 and i > 1000
+                    ? ops[i - recent(gen)].i_
+                    : gen() % (1ul << 40) + 7000);
+  }
+
+  context cxt;
+  const auto run = [&](auto& c, const char* name)
+  {
+    const auto ns = apply(c, ops);
+    const auto& stats = c.statistics();
+    std::cout << name << ": " << ns << " ns/op, " << stats.hits << " hits, max chain "
+              << stats.max_chain << '\n';
+  };
+
+  for (auto size : {1ul << 12, 1ul << 16, 1ul << 20})
+  {
+    std::cout << "cache size " << size << '\n';
+    {
+      basic_cache<cache_conf, context, operation> c(cxt, size);
+      run(c, "  end  ");
+    }
+    {
+      basic_cache<front_insertion_cache_conf, context, operation> c(cxt, size);
+      run(c, "  front");
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_cache_eviction_policy()
+{
+  const auto ops = skewed_operations();
+
+  context cxt;
+  const auto run = [&](auto& c, const char* name)
+  {
+    const auto ns = apply(c, ops);
+    const auto& stats = c.statistics();
+    std::cout << name << ": " << ns << " ns/op, hit ratio " << stats.hit_ratio << ", "
+              << stats.eviction_batches << " evictions\n";
+  };
+
+  for (auto size : {1ul << 10, 1ul << 12, 1ul << 14})
+  {
+    std::cout << "cache size " << size << '\n';
+    {
+      basic_cache<cache_conf, context, operation> c(cxt, size);
+      run(c, "  lru  ");
+    }
+    {
+      basic_cache<clock_cache_conf, context, operation> c(cxt, size);
+      run(c, "  clock");
+    }
+    {
+      basic_cache<batch_eviction_cache_conf, context, operation> c(cxt, size);
+      run(c, "  batch");
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_direct_cache()
+{
+  const auto ops = skewed_operations();
+
+  context cxt;
+  const auto run = [&](auto& c, const char* name)
+  {
+    const auto ns = apply(c, ops);
+    std::cout << name << ": " << ns << " ns/op, hit ratio " << c.statistics().hit_ratio << '\n';
+  };
+
+  for (auto size : {1ul << 12, 1ul << 14, 1ul << 16})
+  {
+    std::cout << "cache size " << size << '\n';
+    {
+      cache<context, operation> c(cxt, size);
+      run(c, "  cache  ");
+    }
+    {
+      direct_cache<context, operation> c(cxt, size);
+      run(c, "  direct ");
+    }
+    {
+      basic_direct_cache<two_way_cache_conf, context, operation> c(cxt, size);
+      run(c, "  two way");
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,57 @@
+#include <algorithm> // max_element, min
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "coredd/hash.hh"
+
+#include "benchmarks/benchmarks.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_hash_policies()
+{
+  const std::size_t nb_keys = 1 << 20;
+  const std::size_t nb_buckets = 1 << 21;
+
+  const auto report = [&](const char* name, auto hash)
+  {
+    std::vector<std::size_t> lengths(nb_buckets);
+    for (auto i = 0ul; i < nb_keys; ++i)
+    {
+      ++lengths[hash(i) & (nb_buckets - 1)];
+    }
+    std::vector<std::size_t> distribution(8);
+    for (auto l : lengths)
+    {
+      ++distribution[std::min(l, distribution.size() - 1)];
+    }
+    std::cout << "  " << name << ':';
+    for (auto i = 0ul; i < distribution.size(); ++i)
+    {
+      std::cout << ' ' << i << (i == distribution.size() - 1 ? "+" : "") << "=" << distribution[i];
+    }
+    std::cout << " (max " << *std::max_element(lengths.begin(), lengths.end()) << ")\n";
+  };
+
+  const auto run = [&](const char* name, auto key)
+  {
+    std::cout << name << '\n';
+    report("identity", [&](std::size_t i){return coredd::identity_mixer{}(key(i));});
+    report("xxh3    ", [&](std::size_t i){return coredd::xxh3_mixer{}(key(i));});
+    report("wyhash  ", [&](std::size_t i){return coredd::wyhash_mixer{}(key(i));});
+  };
+
+  run("sequential integers", [](std::size_t i){return std::hash<std::size_t>()(i);});
+  run("aligned addresses", [](std::size_t i){return 0x7f0000000000ul + i * 48;});
+  run( "pairs of addresses"
+     , [](std::size_t i)
+       {
+         std::size_t seed = 0x7f0000000000ul + (i % 1024) * 48;
+         coredd::hash_combine(seed, 0x7f0000000000ul + (i / 1024) * 48);
+         return seed;
+       });
+}
+
+/*------------------------------------------------------------------------------------------------*/
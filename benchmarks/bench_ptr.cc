@@ -0,0 +1,100 @@
+#include <chrono>
+#include <iostream>
+#include <type_traits> // decay_t
+
+#include "coredd/ptr.hh"
+
+#include "benchmarks/benchmarks.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace coredd {
+
+/// @brief A data released through the deletion handler, a std::function.
+struct bench_unique
+{
+  std::size_t ref_counter_;
+
+  bench_unique()
+    : ref_counter_(0)
+  {}
+
+  void
+  increment_reference_counter()
+  noexcept
+  {
+    ++ref_counter_;
+  }
+
+  bool
+  decrement_reference_counter()
+  noexcept
+  {
+    return --ref_counter_ == 0;
+  }
+
+  bool
+  is_not_referenced()
+  const noexcept
+  {
+    return ref_counter_ == 0;
+  }
+};
+
+/// @brief A data released through a deletion hook bound at compile time.
+struct static_bench_unique
+  : public bench_unique
+{};
+
+std::size_t nb_releases = 0;
+
+template <>
+struct deletion_hook<static_bench_unique>
+{
+  static
+  void
+  release(const static_bench_unique*)
+  noexcept
+  {
+    ++nb_releases;
+  }
+};
+
+} // namespace coredd
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_ptr_copy_destroy()
+{
+  using namespace coredd;
+
+  const auto nb = 50000000ul;
+  const auto run = [&](auto& u, const char* name)
+  {
+    using ptr_type = ptr<std::decay_t<decltype(u)>>;
+    nb_releases = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      // Two references, the last release calls the deletion handler.
+      const ptr_type a{&u};
+      const ptr_type b{a};
+      // Don't let the compiler merge the reference counting of all iterations.
+      asm volatile("" : : "r"(&b) : "memory");
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << name << ": "
+              << std::chrono::duration<double, std::nano>(stop - start).count() / nb
+              << " ns/iteration (" << nb_releases << " releases)\n";
+  };
+
+  bench_unique u;
+  static_bench_unique su;
+  set_deletion_handler<bench_unique>([](const bench_unique*){++nb_releases;});
+  run(u,  "std::function handler");
+  run(su, "compile-time hook    ");
+  reset_deletion_handler<bench_unique>();
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iostream>
+#include <type_traits> // false_type, true_type
+#include <vector>
+
+#include "coredd/cache.hh"
+#include "coredd/unicity.hh"
+
+#include "benchmarks/benchmarks.hh"
+
+using namespace coredd;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct cache_context {};
+
+/// @brief An operation on two unified data, hashed either with their raw addresses (Raw) or with
+/// the hash of ptr.
+template <typename Ptr, bool Raw>
+struct binary_operation
+{
+  Ptr lhs;
+  Ptr rhs;
+
+  std::size_t
+  operator()(cache_context&)
+  const noexcept
+  {
+    return static_cast<std::size_t>(lhs.template get<int>() + rhs.template get<int>());
+  }
+
+  bool
+  operator==(const binary_operation& other)
+  const noexcept
+  {
+    return lhs == other.lhs and rhs == other.rhs;
+  }
+};
+
+} // namespace anonymous
+
+namespace std {
+
+template <typename Ptr, bool Raw>
+struct hash<binary_operation<Ptr, Raw>>
+{
+  std::size_t
+  operator()(const binary_operation<Ptr, Raw>& op)
+  const noexcept
+  {
+    using namespace coredd;
+    if (Raw)
+    {
+      // The former hash of ptr.
+      return seed(op.lhs.operator->()) (val(op.rhs.operator->()));
+    }
+    return seed(op.lhs) (val(op.rhs));
+  }
+};
+
+} // namespace std
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+benchmark_ptr_hash_in_cache()
+{
+  // Don't let the cache mix hash values, to see the effect of the hash of ptr alone.
+  struct unmixed_cache_conf
+    : public cache_conf
+  {
+    using hash_policy = identity_mixer;
+  };
+
+  auto u = unicity<int>{1 << 16};
+  std::vector<unicity<int>::ptr_type> ptrs;
+  for (int i = 0; i < 2048; ++i)
+  {
+    ptrs.push_back(u.make<int>(i));
+  }
+
+  const auto run = [&](auto tag, const char* name)
+  {
+    using operation_type = binary_operation<unicity<int>::ptr_type, decltype(tag)::value>;
+    cache_context cxt;
+    basic_cache<unmixed_cache_conf, cache_context, operation_type> c{cxt, 1 << 18};
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t sum = 0;
+    for (auto i = 0ul; i < 200000; ++i)
+    {
+      sum += c(operation_type{ptrs[i % ptrs.size()], ptrs[(i * 7) / ptrs.size() % ptrs.size()]});
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    const auto& stats = c.statistics();
+    std::cout << name << ": "
+              << std::chrono::duration<double, std::milli>(stop - start).count() << " ms, "
+              << stats.collisions << " collisions, " << stats.alone << " alone, "
+              << stats.empty << " empty, max chain " << stats.max_chain
+              << " (" << sum << ")\n";
+  };
+
+  run(std::true_type{}, "raw address");
+  run(std::false_type{}, "mixed      ");
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,72 @@
+#include <cstring>  // strcmp
+#include <iostream>
+
+#include "benchmarks/benchmarks.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct benchmark
+{
+  const char* name;
+  void (*run)();
+};
+
+const benchmark benchmarks[] =
+  { {"cache_insertion_position", benchmark_cache_insertion_position}
+  , {"cache_eviction_policy", benchmark_cache_eviction_policy}
+  , {"direct_cache", benchmark_direct_cache}
+  , {"hash_policies", benchmark_hash_policies}
+  , {"ptr_copy_destroy", benchmark_ptr_copy_destroy}
+  , {"ptr_hash_in_cache", benchmark_ptr_hash_in_cache}
+  };
+
+void
+run(const benchmark& b)
+{
+  std::cout << "== " << b.name << '\n';
+  b.run();
+}
+
+} // namespace anonymous
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run the benchmarks given on the command line, or all of them.
+int
+main(int argc, char** argv)
+{
+  if (argc == 1)
+  {
+    for (const auto& b : benchmarks)
+    {
+      run(b);
+    }
+    return 0;
+  }
+  for (auto i = 1; i < argc; ++i)
+  {
+    auto found = false;
+    for (const auto& b : benchmarks)
+    {
+      if (std::strcmp(argv[i], b.name) == 0)
+      {
+        run(b);
+        found = true;
+      }
+    }
+    if (not found)
+    {
+      std::cerr << "Unknown benchmark " << argv[i] << ", available ones:\n";
+      for (const auto& b : benchmarks)
+      {
+        std::cerr << "  " << b.name << '\n';
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,31 @@
+#pragma once
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Compare the insertion of new entries at the end or in front of their bucket.
+void
+benchmark_cache_insertion_position();
+
+/// @brief Compare the hit ratios and the costs of the LRU and CLOCK eviction policies.
+void
+benchmark_cache_eviction_policy();
+
+/// @brief Compare the hit ratios and the costs of the cache and of direct caches.
+void
+benchmark_direct_cache();
+
+/// @brief Report the distribution of chain lengths of typical keys under each hash policy.
+void
+benchmark_hash_policies();
+
+/// @brief Compare the cost of copying and releasing ptrs with the default deletion handler, a
+/// std::function, and with a deletion hook bound at compile time.
+void
+benchmark_ptr_copy_destroy();
+
+/// @brief Compare the chains of a cache of operations on ptrs, with the raw address as the hash
+/// value of ptr and with the current hash.
+void
+benchmark_ptr_hash_in_cache();
+
+/*------------------------------------------------------------------------------------------------*/
@@ -6,13 +6,17 @@
 
 #pragma once
 
-#include <memory> // unique_ptr
+#include <algorithm> // max, min
+#include <cassert>
+#include <chrono>
+#include <memory>    // unique_ptr
 #include <tuple>
+#include <vector>
 
+#include "coredd/cache_budget.hh"
+#include "coredd/conf.hh"
 #include "coredd/detail/apply_filters.hh"
 #include "coredd/detail/cache_entry.hh"
-#include "coredd/detail/hash_table.hh"
-#include "coredd/detail/lru_list.hh"
 #include "coredd/detail/pool.hh"
 #include "coredd/hash.hh"
 
@@ -35,9 +39,23 @@ struct cache_statistics
   /// @brief The number of filtered entries.
   std::size_t filtered;
 
-  /// @brief The number of entries discarded by the LRU policy.
+  /// @brief The ratio of hits to looked up operations which were not filtered.
+  ///
+  /// Compare it for each cache_conf::eviction_policy.
+  double hit_ratio;
+
+  /// @brief The number of entries discarded by the eviction policy.
   std::size_t discarded;
 
+  /// @brief The number of times entries have been discarded, see cache_conf::eviction_ratio.
+  std::size_t eviction_batches;
+
+  /// @brief The time spent discarding entries.
+  ///
+  /// Only measured when entries are discarded by batches, as measuring each single eviction
+  /// would cost more than the eviction itself.
+  std::chrono::nanoseconds eviction_time;
+
   /// @brief The number of buckets with more than one element in the underlying hash table.
   std::size_t collisions;
 
@@ -50,23 +68,44 @@ struct cache_statistics
   /// @brief The number of buckets in the underlying hash table.
   std::size_t buckets;
 
+  /// @brief The length of the longest chain met by an insertion in the underlying hash table.
+  ///
+  /// It's a lower bound with COREDD_TAGGED_POINTERS, see longest_chain for exact lengths.
+  std::size_t max_chain;
+
+  /// @brief The length of the longest chain among sampled buckets, 0 if buckets were not sampled.
+  ///
+  /// Unlike max_chain, it's the current length of chains. See statistics(std::size_t).
+  std::size_t longest_chain;
+
   /// @brief The load factor of the underlying hash table.
   double load_factor;
+
+  /// @brief The maximal number of entries.
+  std::size_t capacity;
+
+  /// @brief The number of times the cache has been resized.
+  std::size_t resizes;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief  A generic cache.
+/// @tparam C is the configuration, see cache_conf.
 /// @tparam Operation is the operation type.
 /// @tparam Filters is a list of filters that reject some operations.
 ///
-/// It uses the LRU strategy to cleanup old entries.
-template <typename Context, typename Operation, typename... Filters>
-class cache
+/// When it's full, an entry is discarded for each new one, see cache_conf::eviction_policy. It can
+/// be resized, and adapt its size to its hit ratio within a memory budget (see cache_budget).
+template <typename C, typename Context, typename Operation, typename... Filters>
+class basic_cache
 {
+  static_assert( C::eviction_ratio >= 0 and C::eviction_ratio <= 1
+               , "The eviction ratio must be between 0 and 1");
+
   // Can't copy a cache.
-  cache(const cache&) = delete;
-  cache* operator=(const cache&) = delete;
+  basic_cache(const basic_cache&) = delete;
+  basic_cache* operator=(const basic_cache&) = delete;
 
 private:
 
@@ -77,10 +116,14 @@ private:
   using result_type = std::result_of_t<Operation(context_type&)>;
 
   /// @brief The of an entry that stores an operation and its result.
-  using cache_entry_type = detail::cache_entry<Operation, result_type>;
+  using cache_entry_type = detail::cache_entry<Operation, result_type, C>;
+
+  /// @brief Choose the entries to discard.
+  using eviction_type = typename C::template eviction_policy<cache_entry_type>;
 
   /// @brief An intrusive hash table.
-  using set_type = detail::hash_table<cache_entry_type, false /* no rehash */>;
+  using set_type = typename C::template hash_table_type< cache_entry_type
+                                                       , typename C::hash_policy>;
 
 public:
 
@@ -88,22 +131,55 @@ public:
   /// @param context This cache's context.
   /// @param size How many cache entries are kept, should be greater than the order height.
   ///
-  /// When the maximal size is reached, a cleanup is launched: half of the cache is removed,
-  /// using a LRU strategy. This cache will never perform a rehash, therefore it allocates
-  /// all the memory it needs at its construction.
-  cache(context_type& context, std::size_t size)
+  /// When the maximal size is reached, entries are discarded according to the eviction policy:
+  /// one for each new entry, or a fraction of the cache at once (see cache_conf::eviction_ratio).
+  /// This cache will never perform a rehash, therefore it allocates all the memory it needs at
+  /// its construction.
+  basic_cache(context_type& context, std::size_t size)
     : m_cxt(context)
-    , m_set(size, max_load_factor)
-    , m_lru_list()
-    , m_max_size(m_set.bucket_count() * max_load_factor)
+    , m_size(size)
+    , m_set(std::make_unique<set_type>(size, static_cast<double>(max_load_factor)))
+    , m_max_size(m_set->bucket_count() * max_load_factor)
+    , m_eviction(m_max_size)
     , m_stats()
     , m_pool(m_max_size)
+    , m_depth(0)
+    , m_budget(nullptr)
+    , m_min_size(size)
+    , m_period()
+    , m_state(state::steady)
+    , m_reference_ratio(0)
   {}
 
+  /// @brief Construct an adaptive cache.
+  /// @param context This cache's context.
+  /// @param size The initial and minimal size of the cache, see basic_cache(context_type&, size).
+  /// @param budget The memory shared with other caches, which must outlive this cache.
+  ///
+  /// Every time it has seen as many operations as it can store, the cache checks how it
+  /// performed:
+  ///   - if the budget is exceeded, it shrinks by half, down to its initial size;
+  ///   - if it has discarded entries, it doubles its size, if the budget allows it;
+  ///   - after it has grown, if its hit ratio has not increased by at least
+  ///     cache_conf::adaptive_min_gain, the growth is not worth its memory: it shrinks back and
+  ///     doesn't grow again until its hit ratio decreases by this gain.
+  /// As the cache can only be resized between two evaluations of operations, it only checks it on
+  /// lookups which are not nested in the evaluation of another operation.
+  basic_cache(context_type& context, std::size_t size, cache_budget& budget)
+    : basic_cache(context, size)
+  {
+    m_budget = &budget;
+    m_budget->acquire(memory());
+  }
+
   /// @brief Destructor.
-  ~cache()
+  ~basic_cache()
   {
     clear();
+    if (m_budget != nullptr)
+    {
+      m_budget->release(memory());
+    }
   }
 
   /// @brief Cache lookup.
@@ -117,58 +193,171 @@ public:
       return op(m_cxt);
     }
 
+    if (m_budget != nullptr and m_depth == 0
+        and m_stats.hits + m_stats.misses - m_period.hits - m_period.misses >= m_max_size)
+    {
+      adapt();
+    }
+
     // Lookup for op.
     typename set_type::insert_commit_data commit_data;
-    auto insertion = m_set.insert_check( op
-                                      , [](auto&& lhs, auto&& rhs){return lhs == rhs.operation();}
-                                      , commit_data);
+    auto insertion = m_set->insert_check( op
+                                       , [](auto&& lhs, auto&& rhs){return lhs == rhs.operation();}
+                                       , commit_data);
 
     // Check if op has already been computed.
     if (not insertion.second)
     {
       ++m_stats.hits;
-      // Move cache entry to the end of the LRU list.
-      m_lru_list.splice(m_lru_list.end(), m_lru_list, insertion.first->lru_cit());
+      // Tell the eviction policy that the entry has been used.
+      m_eviction.touch(insertion.first);
       return insertion.first->result();
     }
 
     ++m_stats.misses;
 
     cache_entry_type* entry;
-    auto res = op(m_cxt); // evaluation may throw
+    // The evaluation may throw, and may cache nested operations.
+    auto res = [&]
+    {
+      const depth_guard guard{m_depth};
+      return op(m_cxt);
+    }();
 
     // Clean up the cache, if necessary.
-    if (m_set.size() == m_max_size)
+    if (m_set->size() == m_max_size)
     {
-      auto oldest = m_lru_list.front();
-      m_set.erase(oldest);
-      oldest->~cache_entry_type();
-      m_pool.deallocate(oldest);
-      m_lru_list.pop_front();
-      ++m_stats.discarded;
+      discard();
     }
 
     entry = new (m_pool.allocate()) cache_entry_type(std::move(op), std::move(res));
 
-    // Add the new cache entry to the end of the LRU list.
-    entry->lru_cit() = m_lru_list.insert(m_lru_list.end(), entry);
+    // Add the new cache entry to the eviction policy.
+    m_eviction.insert(entry);
 
     // Finally, set the result associated to op.
-    m_set.insert_commit(entry, commit_data); // doesn't throw
+    m_set->insert_commit(entry, commit_data); // doesn't throw
 
     return entry->result();
   }
 
+  /// @brief Look for several operations at once, without evaluating the missing ones.
+  /// @param ops The operations to look for.
+  /// @param nb_ops The number of operations.
+  /// @param results For each operation, its cached result, or nullptr if it's not in the cache.
+  ///
+  /// The memory accesses of all lookups overlap, which is useful when several independent
+  /// operations are known in advance. Found operations count as hits; the missing ones should be
+  /// evaluated with operator(), which accounts for them. A result may be discarded by the next
+  /// evaluation, thus it must be copied before operator() is called.
+  void
+  lookup(const Operation* ops, std::size_t nb_ops, const result_type** results)
+  {
+    // Filtered operations are never stored, so they are simply not found.
+    for (auto first = 0ul; first < nb_ops; first += set_type::batch_size)
+    {
+      const auto nb = std::min(nb_ops, first + set_type::batch_size) - first;
+      cache_entry_type* entries[set_type::batch_size];
+      m_set->find( ops + first, nb, [](auto&& lhs, auto&& rhs){return lhs == rhs.operation();}
+                 , entries);
+      for (auto i = 0ul; i < nb; ++i)
+      {
+        if (entries[i] == nullptr)
+        {
+          results[first + i] = nullptr;
+          continue;
+        }
+        ++m_stats.hits;
+        m_eviction.touch(entries[i]);
+        results[first + i] = &entries[i]->result();
+      }
+    }
+  }
+
+  /// @brief Look for an operation from a key, without evaluating it if it's missing.
+  /// @param key Must have the same hash value as the operation it's equal to.
+  /// @return The cached result, or nullptr if the operation is not in the cache.
+  ///
+  /// The key only needs to be comparable with operations, so it doesn't have to own what an
+  /// operation stores. For instance, operations on ptrs can be looked up with keys made of
+  /// ptr_refs, which don't update reference counters. A found operation counts as a hit; a missing
+  /// one should be evaluated with operator(), which accounts for it. The result may be discarded by
+  /// the next evaluation, thus it must be copied before operator() is called.
+  template <typename Key>
+  const result_type*
+  find(const Key& key)
+  {
+    auto* entry = m_set->find(key, [](auto&& lhs, auto&& rhs){return lhs == rhs.operation();});
+    if (entry == nullptr)
+    {
+      return nullptr;
+    }
+    ++m_stats.hits;
+    m_eviction.touch(entry);
+    return &entry->result();
+  }
+
   /// @brief Remove all entries of the cache.
   void
   clear()
   noexcept
   {
-    m_set.clear_and_dispose([&](cache_entry_type* x)
+    m_set->clear_and_dispose([&](cache_entry_type* x)
                               {
                                 x->~cache_entry_type();
                                 m_pool.deallocate(x);
                               });
+    m_eviction.clear();
+  }
+
+  /// @brief Change the size of the cache.
+  /// @param size How many cache entries are kept, as for the constructor.
+  ///
+  /// When the cache grows, its entries are kept. When it shrinks, they are all discarded, so the
+  /// memory of the cache is actually released. It must not be called during the evaluation of an
+  /// operation of this cache.
+  void
+  resize(std::size_t size)
+  {
+    assert(m_depth == 0 && "Can't resize a cache while it evaluates an operation");
+    const auto old_memory = memory();
+    auto set = std::make_unique<set_type>(size, static_cast<double>(max_load_factor));
+    const std::size_t max_size = set->bucket_count() * max_load_factor;
+    if (max_size >= m_max_size)
+    {
+      // Allocate everything before moving entries, so that inserting an entry doesn't allocate.
+      m_eviction.reserve(max_size);
+      if (max_size > m_pool.capacity())
+      {
+        m_pool.grow(max_size - m_pool.capacity());
+      }
+      std::vector<cache_entry_type*> entries;
+      entries.reserve(m_set->size());
+      m_set->for_each([&](cache_entry_type& x){entries.push_back(&x);});
+      for (auto x : entries)
+      {
+        x->hook().next = nullptr;
+        typename set_type::insert_commit_data commit_data;
+        set->insert_check( x->operation()
+                         , [](auto&& lhs, auto&& rhs){return lhs == rhs.operation();}
+                         , commit_data);
+        set->insert_commit(x, commit_data);
+      }
+    }
+    else
+    {
+      clear();
+      m_pool = detail::pool<cache_entry_type>(max_size);
+    }
+    m_set = std::move(set);
+    m_size = size;
+    m_max_size = max_size;
+    ++m_stats.resizes;
+    if (m_budget != nullptr)
+    {
+      m_budget->release(old_memory);
+      m_budget->acquire(memory());
+    }
   }
 
   /// @brief Get the number of cached operations.
@@ -176,7 +365,7 @@ public:
   size()
   const noexcept
   {
-    return m_set.size();
+    return m_set->size();
   }
 
   /// @brief Get the statistics of this cache.
@@ -185,36 +374,226 @@ public:
   const noexcept
   {
     m_stats.size = size();
-    std::tie(m_stats.collisions, m_stats.alone, m_stats.empty) = m_set.collisions();
-    m_stats.buckets = m_set.bucket_count();
-    m_stats.load_factor = m_set.load_factor();
+    const auto nb_lookups = m_stats.hits + m_stats.misses;
+    m_stats.hit_ratio = nb_lookups == 0 ? 0 : static_cast<double>(m_stats.hits) / nb_lookups;
+    std::tie(m_stats.collisions, m_stats.alone, m_stats.empty) = m_set->collisions();
+    m_stats.buckets = m_set->bucket_count();
+    m_stats.max_chain = m_set->max_chain();
+    m_stats.longest_chain = 0;
+    m_stats.load_factor = m_set->load_factor();
+    m_stats.capacity = m_max_size;
+    return m_stats;
+  }
+
+  /// @brief Get the statistics of this cache, with the longest chain of a sample of buckets.
+  /// @param nb_samples The number of buckets to inspect.
+  ///
+  /// Its cost is proportional to nb_samples, and to the length of their chains. No bucket is
+  /// sampled if nb_samples is 0.
+  const cache_statistics&
+  statistics(std::size_t nb_samples)
+  const noexcept
+  {
+    statistics();
+    if (nb_samples != 0)
+    {
+      std::tie(std::ignore, std::ignore, std::ignore, m_stats.longest_chain)
+        = m_set->sample_collisions(nb_samples);
+    }
     return m_stats;
   }
 
 private:
 
+  /// @brief Count an evaluation of an operation in progress, even if it throws.
+  struct depth_guard
+  {
+    std::size_t& depth;
+
+    depth_guard(std::size_t& d)
+    noexcept
+      : depth(d)
+    {
+      ++depth;
+    }
+
+    ~depth_guard()
+    {
+      --depth;
+    }
+  };
+
+  /// @brief The state of the adaptation of the size of the cache.
+  enum class state
+  {
+    /// @brief The cache may grow.
+    steady,
+    /// @brief The cache has grown, and checks if it was worth it.
+    judging,
+    /// @brief The cache has shrunk, and is filled again before its hit ratio is measured.
+    warming,
+    /// @brief The cache has shrunk as its last growth was not worth it; its hit ratio is then
+    /// measured.
+    warming_blocked,
+    /// @brief The cache doesn't grow until its hit ratio decreases.
+    blocked
+  };
+
+  /// @brief The memory used by the cache, as accounted in its budget.
+  std::size_t
+  memory()
+  const noexcept
+  {
+    return m_pool.capacity() * sizeof(cache_entry_type) + m_set->bucket_count() * sizeof(void*);
+  }
+
+  /// @brief Grow or shrink the cache depending on its last hit ratio and on its budget.
+  void
+  adapt()
+  {
+    const auto hits = m_stats.hits - m_period.hits;
+    const auto misses = m_stats.misses - m_period.misses;
+    const auto discarded = m_stats.discarded - m_period.discarded;
+    const auto ratio = static_cast<double>(hits) / (hits + misses);
+    m_period = m_stats;
+
+    if (m_budget->exceeded())
+    {
+      if (m_size > m_min_size)
+      {
+        resize(std::max(m_min_size, m_size / 2));
+        m_state = state::warming;
+      }
+      return;
+    }
+    switch (m_state)
+    {
+      case state::warming:
+        m_state = state::steady;
+        return;
+
+      case state::warming_blocked:
+        m_reference_ratio = ratio;
+        m_state = state::blocked;
+        return;
+
+      case state::blocked:
+        if (ratio >= m_reference_ratio - C::adaptive_min_gain)
+        {
+          return;
+        }
+        m_state = state::steady;
+        break;
+
+      case state::judging:
+        if (ratio < m_reference_ratio + C::adaptive_min_gain)
+        {
+          resize(std::max(m_min_size, m_size / 2));
+          m_state = state::warming_blocked;
+          return;
+        }
+        m_state = state::steady;
+        break;
+
+      case state::steady:
+        break;
+    }
+    if (discarded > 0)
+    {
+      // Account for the growth before allocating it, to know if the budget allows it.
+      const auto old_memory = memory();
+      if (m_budget->try_acquire(old_memory))
+      {
+        m_budget->release(old_memory);
+        resize(m_size * 2);
+        m_reference_ratio = ratio;
+        m_state = state::judging;
+      }
+    }
+  }
+
+  /// @brief Discard the entries chosen by the eviction policy to make room for a new one.
+  void
+  discard()
+  noexcept
+  {
+    ++m_stats.eviction_batches;
+    if (C::eviction_ratio == 0)
+    {
+      discard_one();
+      return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto nb = static_cast<std::size_t>(std::max(1.0, m_max_size * C::eviction_ratio));
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      discard_one();
+    }
+    m_stats.eviction_time += std::chrono::steady_clock::now() - start;
+  }
+
+  /// @brief Discard the entry chosen by the eviction policy.
+  void
+  discard_one()
+  noexcept
+  {
+    auto oldest = m_eviction.evict();
+    m_set->erase(oldest);
+    oldest->~cache_entry_type();
+    m_pool.deallocate(oldest);
+    ++m_stats.discarded;
+  }
+
   /// @brief This cache's context.
   context_type& m_cxt;
 
-  /// @brief The wanted load factor for the underlying hash table.
-  static constexpr double max_load_factor = 0.85;
+  /// @brief The size requested at construction or by the last resize.
+  std::size_t m_size;
 
-  /// @brief The actual storage of caches entries.
-  set_type m_set;
+  /// @brief The wanted load factor for the underlying hash table.
+  static constexpr double max_load_factor = C::max_load_factor;
 
-  /// @brief The the container that sorts cache entries by last access date.
-  detail::lru_list<cache_entry_type> m_lru_list;
+  /// @brief The actual storage of caches entries, replaced when the cache is resized.
+  std::unique_ptr<set_type> m_set;
 
   /// @brief The maximum size this cache is authorized to grow to.
   std::size_t m_max_size;
 
+  /// @brief Choose the entries to discard when the cache is full.
+  eviction_type m_eviction;
+
   /// @brief The statistics of this cache
   mutable cache_statistics m_stats;
 
   /// @brief Fixed-size pool allocator for cache entries
   detail::pool<cache_entry_type> m_pool;
+
+  /// @brief The number of evaluations of operations in progress.
+  std::size_t m_depth;
+
+  /// @brief The memory shared by adaptive caches, nullptr if this cache doesn't adapt its size.
+  cache_budget* m_budget;
+
+  /// @brief The size under which an adaptive cache doesn't shrink.
+  const std::size_t m_min_size;
+
+  /// @brief The statistics when an adaptive cache last checked its hit ratio.
+  cache_statistics m_period;
+
+  /// @brief The state of the adaptation of the size of the cache.
+  state m_state;
+
+  /// @brief The hit ratio a growth must improve or, when blocked, the hit ratio which must
+  /// decrease before the cache grows again.
+  double m_reference_ratio;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief A generic cache, using the default configuration.
+template <typename Context, typename Operation, typename... Filters>
+using cache = basic_cache<cache_conf, Context, Operation, Filters...>;
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace coredd
@@ -0,0 +1,114 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <cassert>
+#include <cstddef> // size_t
+
+namespace coredd {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A memory budget shared by adaptive caches.
+///
+/// A cache constructed with a budget grows while growing improves its hit ratio and the budget
+/// has room for it, and shrinks back to its initial size when the budget is exceeded, for instance
+/// after its limit has been lowered. Caches account for the memory of their entries and of their
+/// buckets. Like caches, a budget must not be used by several threads at once.
+class cache_budget
+{
+  // Can't copy a cache_budget.
+  cache_budget(const cache_budget&) = delete;
+  cache_budget& operator=(const cache_budget&) = delete;
+
+public:
+
+  /// @brief Constructor.
+  /// @param limit The number of bytes caches may use together.
+  explicit
+  cache_budget(std::size_t limit)
+  noexcept
+    : m_limit(limit), m_used(0)
+  {}
+
+  /// @brief Get the number of bytes caches may use together.
+  std::size_t
+  limit()
+  const noexcept
+  {
+    return m_limit;
+  }
+
+  /// @brief Change the number of bytes caches may use together.
+  ///
+  /// When it's lowered under the memory already used, caches shrink as they adapt their size.
+  void
+  set_limit(std::size_t limit)
+  noexcept
+  {
+    m_limit = limit;
+  }
+
+  /// @brief Get the number of bytes used by caches.
+  std::size_t
+  used()
+  const noexcept
+  {
+    return m_used;
+  }
+
+  /// @brief Tell if caches use more memory than allowed.
+  bool
+  exceeded()
+  const noexcept
+  {
+    return m_used > m_limit;
+  }
+
+  /// @brief Account for memory used by a cache, even if it exceeds the limit.
+  void
+  acquire(std::size_t bytes)
+  noexcept
+  {
+    m_used += bytes;
+  }
+
+  /// @brief Account for memory used by a cache, only if it doesn't exceed the limit.
+  /// @return false if the memory would exceed the limit.
+  bool
+  try_acquire(std::size_t bytes)
+  noexcept
+  {
+    if (m_used + bytes > m_limit)
+    {
+      return false;
+    }
+    m_used += bytes;
+    return true;
+  }
+
+  /// @brief Memory no longer used by a cache.
+  void
+  release(std::size_t bytes)
+  noexcept
+  {
+    assert(bytes <= m_used);
+    m_used -= bytes;
+  }
+
+private:
+
+  /// @brief The number of bytes caches may use together.
+  std::size_t m_limit;
+
+  /// @brief The number of bytes used by caches.
+  std::size_t m_used;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace coredd
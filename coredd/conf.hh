@@ -0,0 +1,292 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include "coredd/detail/clock_list.hh"
+#include "coredd/detail/flat_hash_table.hh"
+#include "coredd/detail/hash_table.hh"
+#include "coredd/detail/lru_list.hh"
+#include "coredd/detail/node_allocator.hh"
+#include "coredd/detail/reference_counter.hh"
+#include "coredd/hash.hh"
+
+namespace coredd {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The default configuration of a unicity.
+///
+/// To change a policy, inherit from this configuration and shadow the corresponding member.
+struct unicity_conf
+{
+  /// @brief The hash table used to unify data.
+  /// @tparam Hash The hash policy, see hash_policy.
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::hash_table< Data, true /* rehash */, false /* not incremental */
+                                            , false /* back */, Hash>;
+
+  /// @brief Mix the hash values of unified data before they are masked to get a bucket.
+  ///
+  /// Hash values given by std::hash are often weak in their low bits (e.g. identity hash of
+  /// integers, combinations of pointers). See identity_mixer, xxh3_mixer and wyhash_mixer.
+  using hash_policy = xxh3_mixer;
+
+  /// @brief Tell if unified data keep their hash value.
+  ///
+  /// It costs a word per data (32 bits in packed mode), but hash values are never recomputed and
+  /// data are compared only when their hash values are equal.
+  static constexpr bool store_hash = false;
+
+  /// @brief Tell if several threads may create and release unified data at once.
+  ///
+  /// The unique table is then split into nb_shards independently locked parts. It needs a
+  /// thread-safe reference_counter.
+  static constexpr bool concurrent = false;
+
+  /// @brief The reference counter of unified data.
+  ///
+  /// A plain counter is the fastest, but ptrs to the same data can't be copied or released by
+  /// several threads at once. atomic_reference_counter and biased_reference_counter lift this
+  /// restriction, the latter being faster when data are mostly used by the thread which created
+  /// them. Data can be released from any thread only with a concurrent unique table.
+  using reference_counter = detail::plain_reference_counter;
+
+  /// @brief Tell if several unicities of the same type may exist at once.
+  ///
+  /// Each unified data then keeps a pointer to the unique table of its unicity, to which it's
+  /// given back when it's no longer referenced. Otherwise, the release of data goes to the
+  /// unique table of the last constructed unicity, without this extra word per data.
+  static constexpr bool multiple_instances = false;
+
+  /// @brief The number of parts of a concurrent unique table, must be a power of 2.
+  static constexpr std::size_t nb_shards = 64;
+
+  /// @brief The load factor above which the unique table grows.
+  static constexpr double max_load_factor = 0.75;
+
+  /// @brief The load factor under which the unique table shrinks when data are erased.
+  ///
+  /// The unique table then shrinks to a load factor of about max_load_factor / 2, so it doesn't
+  /// oscillate between growing and shrinking. 0 disables automatic shrinking, unicity::compact()
+  /// can still be called explicitly, for instance after a garbage collection.
+  static constexpr double min_load_factor = 0;
+
+  /// @brief The number of no longer referenced data kept in the unique table before they are
+  /// reclaimed.
+  ///
+  /// Such dead data are revived for free when they are unified again, which often happens soon
+  /// after their release. When there are dead_threshold of them, they are all reclaimed at once. 0
+  /// reclaims data as soon as they are no longer referenced. Ignored by the concurrent unique
+  /// table, which always reclaims data at once. Otherwise, dead data are linked together, which
+  /// costs two pointers per data.
+  static constexpr std::size_t dead_threshold = 0;
+
+  /// @brief The allocator of the memory of unified data.
+  ///
+  /// Ignored by the concurrent unique table, which always allocates data on the heap.
+  using allocator_type = detail::heap_allocator;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration which allocates unified data in slabs of same-sized blocks.
+///
+/// Data of the same size are packed together and allocations are cheaper than with the heap. As
+/// the memory of all data is released with the unicity, no data must be alive at this point: it's
+/// asserted in debug builds.
+struct slab_unicity_conf
+  : public unicity_conf
+{
+  using allocator_type = detail::slab_allocator;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration which keeps released data for a while, to revive them if they
+/// are unified again.
+struct deferred_unicity_conf
+  : public unicity_conf
+{
+  static constexpr std::size_t dead_threshold = 4096;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration for which several unicities of the same type may exist at once.
+struct multiple_unicity_conf
+  : public unicity_conf
+{
+  static constexpr bool multiple_instances = true;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration which can be used by several threads at once.
+struct concurrent_unicity_conf
+  : public unicity_conf
+{
+  static constexpr bool concurrent = true;
+  using reference_counter = detail::atomic_reference_counter;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration which can be used by several threads at once, with reference
+/// counters biased towards the thread which created data.
+struct biased_concurrent_unicity_conf
+  : public concurrent_unicity_conf
+{
+  using reference_counter = detail::biased_reference_counter;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration using an open-addressing hash table.
+struct flat_unicity_conf
+  : public unicity_conf
+{
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::flat_hash_table<Data, true /* rehash */, Hash>;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A unicity configuration which spreads the rehash of its unique table over subsequent
+/// operations.
+struct incremental_unicity_conf
+  : public unicity_conf
+{
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::hash_table< Data, true /* rehash */, true /* incremental */
+                                            , false /* back */, Hash>;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The default configuration of a cache.
+///
+/// To change a policy, inherit from this configuration and shadow the corresponding member.
+struct cache_conf
+{
+  /// @brief The hash table used to store cache entries.
+  /// @tparam Hash The hash policy, see hash_policy.
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::hash_table< Data, false /* no rehash */
+                                            , false /* not incremental */, false /* back */, Hash>;
+
+  /// @brief Mix the hash values of operations before they are masked to get a bucket.
+  using hash_policy = xxh3_mixer;
+
+  /// @brief The load factor of the hash table of a full cache.
+  static constexpr double max_load_factor = 0.85;
+
+  /// @brief Tell if cache entries keep the hash value of their operation.
+  ///
+  /// It costs a word per entry (32 bits in packed mode), but operations are compared only when
+  /// their hash values are equal.
+  static constexpr bool store_hash = false;
+
+  /// @brief Choose the entry discarded when the cache is full.
+  ///
+  /// lru_list discards the least recently used entry, but each hit moves its entry to the back of
+  /// a list, which writes to the entry and to its neighbours. clock_list only sets a bit in the
+  /// entry, at the cost of a less accurate order. A policy is constructed with the maximal number
+  /// of entries, and reserve() is called with the new one when the cache grows, so that inserting
+  /// an entry doesn't allocate.
+  template <typename Entry>
+  using eviction_policy = detail::lru_list<Entry>;
+
+  /// @brief The fraction of the entries discarded at once when the cache is full.
+  ///
+  /// 0 discards a single entry for each new one, so all misses of a full cache pay for an
+  /// eviction. Otherwise, the coldest entries are discarded in a single pass, and the following
+  /// misses don't discard anything until the cache is full again, at the cost of a lower hit
+  /// ratio.
+  static constexpr double eviction_ratio = 0;
+
+  /// @brief The increase of the hit ratio for which an adaptive cache keeps its last growth.
+  ///
+  /// See basic_cache(context_type&, std::size_t, cache_budget&).
+  static constexpr double adaptive_min_gain = 0.01;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A cache configuration which inserts new entries in front of their bucket.
+///
+/// Recently cached operations are then found first, but chains are reordered by each insertion.
+struct front_insertion_cache_conf
+  : public cache_conf
+{
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::hash_table< Data, false /* no rehash */
+                                            , false /* not incremental */, true /* front */, Hash>;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A cache configuration using an open-addressing hash table.
+struct flat_cache_conf
+  : public cache_conf
+{
+  template <typename Data, typename Hash>
+  using hash_table_type = detail::flat_hash_table<Data, false /* no rehash */, Hash>;
+
+  /// @brief Leave room for the deleted slots left by evictions.
+  ///
+  /// The table reclaims them with a pass over all slots when 7/8 of the slots are used. Closer to
+  /// this threshold, a full cache which discards an entry for each miss reclaims them much more
+  /// often: every 0.08 * size insertions at 0.85, every 1.5 * size insertions at 0.7.
+  static constexpr double max_load_factor = 0.7;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A cache configuration which discards half of its entries at once when it's full.
+struct batch_eviction_cache_conf
+  : public cache_conf
+{
+  static constexpr double eviction_ratio = 0.5;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A cache configuration which discards entries with the CLOCK (second chance) policy.
+struct clock_cache_conf
+  : public cache_conf
+{
+  template <typename Entry>
+  using eviction_policy = detail::clock_list<Entry>;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The default configuration of a direct-mapped cache, see basic_direct_cache.
+struct direct_cache_conf
+{
+  /// @brief Mix the hash values of operations before they are masked to get a set.
+  using hash_policy = xxh3_mixer;
+
+  /// @brief The number of entries of a set, where an operation can be stored: 1 or 2.
+  ///
+  /// With 2 ways, a new operation overwrites the least recently used entry of its set, so two
+  /// frequent operations of the same set don't keep overwriting each other.
+  static constexpr std::size_t ways = 1;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A configuration of a 2-way set-associative direct cache.
+struct two_way_cache_conf
+  : public direct_cache_conf
+{
+  static constexpr std::size_t ways = 2;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace coredd
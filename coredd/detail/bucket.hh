@@ -0,0 +1,131 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uintptr_t
+
+#if defined COREDD_TAGGED_POINTERS && (defined __x86_64__ || defined _M_X64 || defined __aarch64__)
+#  define COREDD_TAGGED_BUCKETS
+#endif
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The head of a chain of elements of a hash_table.
+///
+/// When COREDD_TAGGED_POINTERS is defined on a 64-bit platform whose addresses fit in 48 bits
+/// (x86-64, AArch64), the 16 unused high bits of the head pointer summarize the hash values of all
+/// chained elements: each element sets one of the 16 bits. A lookup whose bit isn't set can then
+/// be rejected without dereferencing any element. Bits are not unset when an element is removed,
+/// but when the bucket becomes empty, so the summary may only give false positives.
+///
+/// Otherwise, it's a plain pointer and all lookups walk the chain.
+template <typename Data>
+class bucket
+{
+public:
+
+  /// @brief Tell if chains are summarized in the head pointers.
+#ifdef COREDD_TAGGED_BUCKETS
+  static constexpr bool tagged = true;
+#else
+  static constexpr bool tagged = false;
+#endif
+
+  /// @brief The first element of the chain.
+  Data*
+  head()
+  const noexcept
+  {
+#ifdef COREDD_TAGGED_BUCKETS
+    return reinterpret_cast<Data*>(m_value & pointer_mask);
+#else
+    return m_head;
+#endif
+  }
+
+  /// @brief Change the first element of the chain, without changing the summary.
+  ///
+  /// The summary is cleared if the chain becomes empty.
+  void
+  set_head(Data* x)
+  noexcept
+  {
+#ifdef COREDD_TAGGED_BUCKETS
+    m_value = x == nullptr ? 0 : (m_value & ~pointer_mask) | reinterpret_cast<std::uintptr_t>(x);
+#else
+    m_head = x;
+#endif
+  }
+
+  /// @brief Push an element in front of the chain.
+  void
+  push_front(Data* x, std::size_t hash)
+  noexcept
+  {
+    x->hook().next = head();
+    set_head(x);
+    add(hash);
+  }
+
+  /// @brief Take into account an element added to the chain.
+  void
+  add(std::size_t hash)
+  noexcept
+  {
+#ifdef COREDD_TAGGED_BUCKETS
+    m_value |= tag(hash);
+#else
+    static_cast<void>(hash);
+#endif
+  }
+
+  /// @brief Tell if an element with the given hash value may be in the chain.
+  bool
+  may_contain(std::size_t hash)
+  const noexcept
+  {
+#ifdef COREDD_TAGGED_BUCKETS
+    return (m_value & tag(hash)) != 0;
+#else
+    static_cast<void>(hash);
+    return true;
+#endif
+  }
+
+private:
+
+#ifdef COREDD_TAGGED_BUCKETS
+  static constexpr std::uintptr_t pointer_mask = (std::uintptr_t{1} << 48) - 1;
+
+  /// @brief The bit of the summary set by a hash value.
+  ///
+  /// Only the 32 lowest bits are used, as it's all that is kept by packed hooks. They are mixed so
+  /// the bit doesn't depend on the bits that select the bucket only.
+  static
+  std::uintptr_t
+  tag(std::size_t hash)
+  noexcept
+  {
+    const auto mixed = static_cast<std::uint32_t>(hash) * std::uint32_t{0x9e3779b9};
+    return std::uintptr_t{1} << (48 + (mixed >> 28));
+  }
+
+  /// @brief The head pointer in the 48 lowest bits, the summary in the 16 highest.
+  std::uintptr_t m_value = 0;
+#else
+  /// @brief The first element of the chain.
+  Data* m_head = nullptr;
+#endif
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
@@ -7,11 +7,10 @@
 #pragma once
 
 #include <functional> // hash
-#include <list>
 #include <utility>    // forward
 
-#include "coredd/detail/hash_table.hh"
-#include "coredd/detail/lru_list.hh"
+#include "coredd/conf.hh"
+#include "coredd/detail/intrusive_member_hook.hh"
 #include "coredd/hash.hh"
 
 namespace coredd { namespace detail {
@@ -21,7 +20,8 @@ namespace coredd { namespace detail {
 /// @brief Associate an operation to its result into the cache.
 ///
 /// The operation acts as a key and the associated result is the value counterpart.
-template <typename Operation, typename Result>
+/// @tparam C The configuration of the cache owning this entry.
+template <typename Operation, typename Result, typename C = cache_conf>
 class cache_entry
 {
 public:
@@ -34,18 +34,25 @@ public:
   template <typename... Args>
   cache_entry(Operation&& op, Args&&... args)
     : m_hook()
+    , m_eviction_hook()
     , m_operation(std::move(op))
     , m_result(std::forward<Args>(args)...)
-    , m_lru_cit()
   {}
 
-  intrusive_member_hook<cache_entry>&
+  member_hook<cache_entry, C::store_hash>&
   hook()
   noexcept
   {
     return m_hook;
   }
 
+  const member_hook<cache_entry, C::store_hash>&
+  hook()
+  const noexcept
+  {
+    return m_hook;
+  }
+
   const Operation&
   operation()
   const noexcept
@@ -60,18 +67,12 @@ public:
     return m_result;
   }
 
-  auto
-  lru_cit()
-  const noexcept
-  {
-    return m_lru_cit;
-  }
-
+  /// @brief The data of the eviction policy of the cache, see cache_conf::eviction_policy.
   auto&
-  lru_cit()
+  eviction_hook()
   noexcept
   {
-    return m_lru_cit;
+    return m_eviction_hook;
   }
 
   /// @brief Cache entries are only compared using their operations.
@@ -86,16 +87,17 @@ public:
 private:
 
   /// @brief
-  intrusive_member_hook<cache_entry> m_hook;
+  member_hook<cache_entry, C::store_hash> m_hook;
+
+  /// @brief Used by the eviction policy, next to the other hook so a hit only touches the cache
+  /// line of this entry.
+  typename C::template eviction_policy<cache_entry>::hook_type m_eviction_hook;
 
   /// @brief The cached operation.
   const Operation m_operation;
 
   /// @brief The result of the evaluation of operation.
   const Result m_result;
-
-  /// @brief Where this cache entry is stored in the LRU list.
-  typename lru_list<cache_entry>::const_iterator m_lru_cit;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -107,11 +109,11 @@ namespace std {
 /*------------------------------------------------------------------------------------------------*/
 
 /// @internal
-template <typename Operation, typename Result>
-struct hash<coredd::detail::cache_entry<Operation, Result>>
+template <typename Operation, typename Result, typename C>
+struct hash<coredd::detail::cache_entry<Operation, Result, C>>
 {
   std::size_t
-  operator()(const coredd::detail::cache_entry<Operation, Result>& x)
+  operator()(const coredd::detail::cache_entry<Operation, Result, C>& x)
   {
     using namespace coredd;
     // A cache entry must have the same hash as its contained operation. Otherwise, cache::erase()
@@ -0,0 +1,165 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <cassert>
+#include <cstddef> // size_t
+#include <vector>
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The reference bit of an element of a clock_list, embedded in this element.
+struct clock_hook
+{
+  /// @brief Tell if the element has been used since the hand of the clock last passed it.
+  bool referenced = false;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The container that approximates the access order of cache entries with the CLOCK
+/// (second chance) policy.
+///
+/// Elements are placed on a circle, in insertion order. Using an element only sets its reference
+/// bit, given by eviction_hook(), which is written only if it was not already set. To evict an
+/// element, the hand of the clock goes around the circle, clearing the reference bits it meets,
+/// and stops at the first element whose bit is clear, leaving a hole. Several elements can be
+/// evicted in a row; the next inserted elements fill the holes, the last one first, so they are
+/// behind the hand. Hits are thus cheaper than with lru_list, at the cost of a less accurate
+/// eviction order.
+template <typename T>
+class clock_list
+{
+  // Can't copy a clock_list.
+  clock_list(const clock_list&) = delete;
+  clock_list& operator=(const clock_list&) = delete;
+
+public:
+
+  /// @brief The reference bit embedded in elements.
+  using hook_type = clock_hook;
+
+  /// @brief Constructor.
+  /// @param capacity The maximal number of elements.
+  explicit
+  clock_list(std::size_t capacity)
+    : m_slots(), m_holes(), m_hand(0)
+  {
+    m_slots.reserve(capacity);
+    m_holes.reserve(capacity);
+  }
+
+  bool
+  empty()
+  const noexcept
+  {
+    return m_slots.size() == m_holes.size();
+  }
+
+  /// @brief Make room for more elements, when the cache grows.
+  void
+  reserve(std::size_t capacity)
+  {
+    m_slots.reserve(capacity);
+    m_holes.reserve(capacity);
+  }
+
+  /// @brief Insert an element, which is not referenced yet.
+  ///
+  /// It takes the place of the last evicted element, if any.
+  void
+  insert(T* x)
+  {
+    x->eviction_hook().referenced = false;
+    if (not m_holes.empty())
+    {
+      m_slots[m_holes.back()] = x;
+      m_holes.pop_back();
+    }
+    else
+    {
+      m_slots.push_back(x);
+    }
+  }
+
+  /// @brief Remove and get the first element met by the hand of the clock which is not referenced.
+  T*
+  evict()
+  noexcept
+  {
+    assert(not empty());
+    while (true)
+    {
+      auto* x = m_slots[m_hand];
+      if (x != nullptr)
+      {
+        auto& hook = x->eviction_hook();
+        if (not hook.referenced)
+        {
+          m_slots[m_hand] = nullptr;
+          m_holes.push_back(m_hand);
+          advance();
+          return x;
+        }
+        hook.referenced = false;
+      }
+      advance();
+    }
+  }
+
+  /// @brief Give a second chance to an element.
+  void
+  touch(T* x)
+  noexcept
+  {
+    auto& hook = x->eviction_hook();
+    // Don't dirty the cache line of the element if it's already referenced.
+    if (not hook.referenced)
+    {
+      hook.referenced = true;
+    }
+  }
+
+  /// @brief Forget all elements, which are not modified.
+  void
+  clear()
+  noexcept
+  {
+    m_slots.clear();
+    m_holes.clear();
+    m_hand = 0;
+  }
+
+private:
+
+  void
+  advance()
+  noexcept
+  {
+    if (++m_hand == m_slots.size())
+    {
+      m_hand = 0;
+    }
+  }
+
+  /// @brief The elements, in insertion order, and nullptr for evicted ones not yet replaced.
+  std::vector<T*> m_slots;
+
+  /// @brief The positions of the evicted elements not yet replaced, the last evicted at the back.
+  std::vector<std::size_t> m_holes;
+
+  /// @brief The position of the hand of the clock.
+  std::size_t m_hand;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
@@ -0,0 +1,328 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <algorithm>  // max
+#include <cassert>
+#include <cstdint>    // uint64_t
+#include <functional> // hash
+#include <memory>     // unique_ptr
+#include <mutex>
+#include <thread>     // yield
+#include <tuple>
+#include <vector>
+
+#include "coredd/conf.hh"
+#include "coredd/detail/unique_table.hh"
+#include "coredd/lookup.hh"
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A table to unify data, which can be used by several threads at once.
+/// @tparam C The configuration of the unicity owning this table.
+///
+/// The table is split into C::nb_shards independent hash tables, each protected by its own mutex.
+/// A data goes to the shard given by the high bits of its hash value, the low bits being used by
+/// the hash tables themselves.
+///
+/// Unified data must be reference-counted atomically. Unlike unique_table, the reference of the
+/// caller is taken while the shard is locked: a data whose last reference was dropped by another
+/// thread is never returned, as this thread is about to erase it.
+template <typename Unique, typename C = unicity_conf>
+class concurrent_unique_table
+{
+  static_assert( C::nb_shards != 0 and (C::nb_shards & (C::nb_shards - 1)) == 0
+               , "The number of shards must be a power of 2");
+  static_assert( C::reference_counter::thread_safe
+               , "A concurrent unique table needs a thread-safe reference counter");
+  static_assert( C::min_load_factor < C::max_load_factor / 2
+               , "The unique table would grow again just after having shrunk");
+
+private:
+
+  /// @brief A part of the table.
+  struct shard
+  {
+    shard(std::size_t initial_size)
+      : mutex{}
+      , set{initial_size, C::max_load_factor, C::min_load_factor}
+      , stats{}
+    {}
+
+    /// @brief Protect all other members.
+    std::mutex mutex;
+
+    /// @brief The actual container of unified data of this shard.
+    typename C::template hash_table_type<Unique, typename C::hash_policy> set;
+
+    /// @brief The statistics of this shard.
+    unique_table_statistics stats;
+  };
+
+public:
+
+  // Can't copy a concurrent_unique_table.
+  concurrent_unique_table(const concurrent_unique_table&) = delete;
+  concurrent_unique_table& operator=(const concurrent_unique_table&) = delete;
+
+  /// @brief Constructor.
+  /// @param initial_size Initial capacity of the container.
+  concurrent_unique_table(std::size_t initial_size)
+    : m_shards{std::make_unique<std::unique_ptr<shard>[]>(C::nb_shards)}
+  {
+    const std::size_t min_size = 16;
+    const auto shard_size = std::max(initial_size / C::nb_shards, min_size);
+    for (auto i = 0ul; i < C::nb_shards; ++i)
+    {
+      m_shards[i] = std::make_unique<shard>(shard_size);
+    }
+  }
+
+  /// @brief Destructor.
+  ///
+  /// Immortal data are destroyed, thus no ptr to a data of this table must outlive it. No other
+  /// thread must use this table anymore.
+  ~concurrent_unique_table()
+  {
+    std::vector<const Unique*> immortals;
+    for (auto i = 0ul; i < C::nb_shards; ++i)
+    {
+      m_shards[i]->set.for_each([&](const Unique& x)
+      {
+        if (x.is_immortal())
+        {
+          immortals.push_back(&x);
+        }
+      });
+    }
+    for (const auto* x : immortals)
+    {
+      auto& s = get_shard(hash_of<typename C::hash_policy>(*x));
+      s.set.erase(x);
+      reclaim(x);
+    }
+  }
+
+  /// @brief Unify a data.
+  /// @param ptr A pointer to a data constructed with a placement new into the storage returned by
+  /// allocate().
+  /// @return A reference to the unified data, which has been referenced once for the caller.
+  Unique&
+  operator()(Unique* ptr, std::size_t)
+  {
+    assert(ptr != nullptr);
+    auto& s = get_shard(typename C::hash_policy{}(std::hash<Unique>()(*ptr)));
+    while (true)
+    {
+      std::unique_lock<std::mutex> lock{s.mutex};
+      ++s.stats.access;
+      auto insertion = s.set.insert(ptr);
+      if (insertion.second)
+      {
+        ++s.stats.misses;
+        s.stats.peak = std::max(s.stats.peak, s.set.size());
+        ptr->increment_reference_counter();
+        return *ptr;
+      }
+      if (insertion.first->try_increment_reference_counter())
+      {
+        ++s.stats.hits;
+        lock.unlock();
+        ptr->~Unique();
+        delete[] reinterpret_cast<char*>(ptr);  // match new char[] of allocate().
+        return *insertion.first;
+      }
+      // The existing data is being erased by another thread, wait for it to be gone.
+      --s.stats.access;
+      lock.unlock();
+      std::this_thread::yield();
+    }
+  }
+
+  /// @brief Look for an already unified data.
+  /// @param hash The hash value of the data, as computed by std::hash<Unique>.
+  /// @param eq Tell if a unified data is the one looked for.
+  /// @return The unified data, which has been referenced once for the caller, or nullptr if there
+  /// is none.
+  ///
+  /// A data being erased by another thread is not found. Only hits are recorded, as a miss is
+  /// followed by the unification of the data.
+  template <typename EqT>
+  Unique*
+  find(std::size_t hash, EqT eq)
+  {
+    auto& s = get_shard(typename C::hash_policy{}(hash));
+    std::lock_guard<std::mutex> lock{s.mutex};
+    auto* res = s.set.find(hashed_key{hash}, [&](const hashed_key&, const Unique& u){return eq(u);});
+    if (res == nullptr or not res->try_increment_reference_counter())
+    {
+      return nullptr;
+    }
+    ++s.stats.access;
+    ++s.stats.hits;
+    return res;
+  }
+
+  /// @brief Allocate a memory block large enough for the given size.
+  char*
+  allocate(std::size_t extra_bytes)
+  {
+    return new char[sizeof(Unique) + extra_bytes];
+  }
+
+  /// @brief Erase the given unified data.
+  ///
+  /// Must be called only by the thread which dropped the last reference to x.
+  void
+  erase(const Unique* x)
+  noexcept
+  {
+    assert(x != nullptr);
+    assert(x->is_not_referenced() && "Unique still referenced");
+    auto& s = get_shard(hash_of<typename C::hash_policy>(*x));
+    {
+      std::lock_guard<std::mutex> lock{s.mutex};
+      s.set.erase(x);
+    }
+    // Destroy outside of the lock, as it may erase other data.
+    reclaim(x);
+  }
+
+  /// @brief Release unused memory.
+  /// @return true if at least one shard has been shrunk.
+  bool
+  compact()
+  noexcept
+  {
+    auto res = false;
+    for (auto i = 0ul; i < C::nb_shards; ++i)
+    {
+      auto& s = *m_shards[i];
+      std::lock_guard<std::mutex> lock{s.mutex};
+      res = s.set.compact() or res;
+    }
+    return res;
+  }
+
+  /// @brief Get the statistics of this unique_table.
+  ///
+  /// The peak is the sum of the peaks of all shards, thus an upper bound of the actual peak.
+  unique_table_statistics
+  stats()
+  const
+  {
+    return stats(0);
+  }
+
+  /// @brief Get the statistics of this unique_table, with the longest chain of a sample of
+  /// buckets.
+  /// @param nb_samples The number of buckets to inspect, spread over all shards.
+  ///
+  /// No bucket is sampled if nb_samples is 0.
+  unique_table_statistics
+  stats(std::size_t nb_samples)
+  const
+  {
+    unique_table_statistics res{};
+    for (auto i = 0ul; i < C::nb_shards; ++i)
+    {
+      auto& s = *m_shards[i];
+      std::lock_guard<std::mutex> lock{s.mutex};
+      std::size_t col, alone, empty;
+      std::tie(col, alone, empty) = s.set.collisions();
+      res.size += s.set.size();
+      res.peak += s.stats.peak;
+      res.access += s.stats.access;
+      res.hits += s.stats.hits;
+      res.misses += s.stats.misses;
+      res.rehash += s.set.nb_rehash();
+      res.shrink += s.set.nb_shrink();
+      res.collisions += col;
+      res.alone += alone;
+      res.empty += empty;
+      res.buckets += s.set.bucket_count();
+      res.max_chain = std::max(res.max_chain, s.set.max_chain());
+      if (nb_samples != 0)
+      {
+        std::size_t longest;
+        std::tie(std::ignore, std::ignore, std::ignore, longest)
+          = s.set.sample_collisions(std::max(nb_samples / C::nb_shards, std::size_t{1}));
+        res.longest_chain = std::max(res.longest_chain, longest);
+      }
+    }
+    res.load_factor = static_cast<double>(res.size) / static_cast<double>(res.buckets);
+    return res;
+  }
+
+private:
+
+  /// @brief Destroy a data which is no longer in the table, as well as the data it releases.
+  ///
+  /// As unique_table::reclaim(), the data released by a destruction are queued rather than
+  /// destroyed recursively. Each thread has its own queue, shared by all tables of the same type,
+  /// as the memory of data doesn't depend on the table.
+  static
+  void
+  reclaim(const Unique* x)
+  noexcept
+  {
+    static thread_local Unique* pending = nullptr;
+    static thread_local bool reclaiming = false;
+    auto* u = const_cast<Unique*>(x);
+    u->hook().next = pending;
+    pending = u;
+    if (reclaiming)
+    {
+      return;
+    }
+    reclaiming = true;
+    while (pending != nullptr)
+    {
+      auto* y = pending;
+      pending = y->hook().next;
+      y->~Unique();
+      delete[] reinterpret_cast<const char*>(y); // match new char[] of allocate().
+    }
+    reclaiming = false;
+  }
+
+  /// @brief Get the shard of a data from its hash value.
+  shard&
+  get_shard(std::size_t hash)
+  const noexcept
+  {
+    // Fibonacci hashing: the high bits of the product depend on all bits of the hash value. Only
+    // the 32 lowest bits are used, as it's all that is kept by packed hooks (see hash_of()).
+    const std::uint64_t h = static_cast<std::uint32_t>(hash);
+    const auto mixed = h * 0x9e3779b97f4a7c15ull;
+    return *m_shards[shift() == 0 ? 0 : static_cast<std::size_t>(mixed >> (64 - shift()))];
+  }
+
+  /// @brief log2(C::nb_shards).
+  static
+  constexpr
+  unsigned int
+  shift()
+  noexcept
+  {
+    unsigned int res = 0;
+    for (auto n = C::nb_shards; n > 1; n >>= 1)
+    {
+      ++res;
+    }
+    return res;
+  }
+
+  /// @brief The shards, allocated separately as they can't be moved.
+  std::unique_ptr<std::unique_ptr<shard>[]> m_shards;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
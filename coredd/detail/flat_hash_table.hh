@@ -0,0 +1,853 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <algorithm>   // fill, for_each, max, min
+#include <cassert>
+#include <cstdint>     // int8_t, uint32_t
+#include <functional>  // hash
+#include <memory>      // unique_ptr
+#include <new>         // nothrow
+#include <tuple>
+#include <utility>     // pair, swap
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "coredd/detail/intrusive_member_hook.hh"
+#include "coredd/detail/next_power.hh"
+#include "coredd/detail/prefetch.hh"
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The control bytes of a group of slots in a flat_hash_table.
+///
+/// A control byte is either empty, deleted or holds the 7 lowest bits of the hash value of the
+/// data stored in the corresponding slot.
+struct ctrl_group
+{
+  /// @brief The number of slots in a group.
+  static constexpr std::size_t width = 16;
+
+  static constexpr std::int8_t empty = -128;   // 0b10000000
+  static constexpr std::int8_t deleted = -2;   // 0b11111110
+
+  /// @brief A bitmask of matching slots, bit i is set if slot i matches.
+  using mask_type = std::uint32_t;
+
+  alignas(width) std::int8_t bytes[width];
+
+  static
+  bool
+  is_full(std::int8_t c)
+  noexcept
+  {
+    return c >= 0;
+  }
+
+#if defined(__SSE2__)
+
+  mask_type
+  match(std::int8_t h2)
+  const noexcept
+  {
+    const auto ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<mask_type>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+  }
+
+  mask_type
+  match_empty()
+  const noexcept
+  {
+    return match(empty);
+  }
+
+  mask_type
+  match_empty_or_deleted()
+  const noexcept
+  {
+    // empty and deleted are the only control bytes lower than -1.
+    const auto ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<mask_type>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl)));
+  }
+
+#else
+
+  mask_type
+  match(std::int8_t h2)
+  const noexcept
+  {
+    mask_type res = 0;
+    for (auto i = 0ul; i < width; ++i)
+    {
+      res |= static_cast<mask_type>(bytes[i] == h2) << i;
+    }
+    return res;
+  }
+
+  mask_type
+  match_empty()
+  const noexcept
+  {
+    return match(empty);
+  }
+
+  mask_type
+  match_empty_or_deleted()
+  const noexcept
+  {
+    mask_type res = 0;
+    for (auto i = 0ul; i < width; ++i)
+    {
+      res |= static_cast<mask_type>(bytes[i] < -1) << i;
+    }
+    return res;
+  }
+
+#endif
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief An intrusive hash table using open addressing.
+/// @tparam Rehash Tell if the table grows when its maximal load factor is reached.
+/// @tparam Hash The hash policy applied to the values given by std::hash, see identity_mixer.
+///
+/// It stores pointers to data in a flat array of slots. A parallel array of control bytes keeps
+/// 7 bits of the hash value of each stored data; slots are probed by groups of 16, comparing all
+/// control bytes of a group at once (with SSE2 when available). Thus, most of the unsuccessful
+/// comparisons are performed without dereferencing a data.
+///
+/// It has the same interface as hash_table, but Data doesn't need to have a hook, unless it's used
+/// to keep the hash value of the data (see hashed_member_hook).
+///
+/// A growable table shrinks when its load factor falls under a minimal load factor (never, by
+/// default) or when compact() is called.
+///
+/// The number of elements out of their home group is maintained on each insertion and removal,
+/// thus collisions() doesn't have to walk the whole table.
+///
+/// As hash_table, it provides batched versions of find() and insert_check() which prefetch the
+/// groups of the keys one batch before probing them.
+template <typename Data, bool Rehash = true, typename Hash = identity_mixer>
+class flat_hash_table
+{
+public:
+
+  /// @brief Used by insert_check
+  struct insert_commit_data
+  {
+    std::size_t slot;
+    std::size_t hash;
+    /// @brief The number of rehashes when the slot was chosen.
+    std::size_t nb_rehash;
+  };
+
+  /// @brief The number of keys of a batched lookup which are prefetched together.
+  static constexpr std::size_t batch_size = 8;
+
+public:
+
+  flat_hash_table(std::size_t size, double max_load_factor = 0.75, double min_load_factor = 0)
+    : m_nb_groups(nb_groups(size))
+    , m_min_nb_groups(m_nb_groups)
+    , m_size(0)
+    , m_nb_deleted(0)
+    , m_ctrl(std::make_unique<ctrl_group[]>(m_nb_groups))
+    , m_slots(std::make_unique<Data*[]>(bucket_count()))
+    , m_max_load_factor(max_load_factor)
+    , m_min_load_factor(min_load_factor)
+    , m_nb_rehash(0)
+    , m_nb_shrink(0)
+    , m_nb_displaced(0)
+    , m_max_chain(0)
+  {
+    assert( (min_load_factor < max_load_factor / 2)
+          && "The table would grow again just after having shrunk");
+    reset_ctrl(m_ctrl.get(), m_nb_groups);
+  }
+
+  template <typename T, typename EqT>
+  std::pair<Data*, bool>
+  insert_check(const T& x, EqT eq, insert_commit_data& commit_data)
+  const noexcept(noexcept(std::hash<T>()(x)))
+  {
+    static_assert(not Rehash, "Use with fixed-size hash table only");
+    return insert_check_impl(x, mixed_hash<Data, Hash>(x), eq, commit_data);
+  }
+
+  /// @brief Check the insertion of several keys at once.
+  /// @param keys The keys to check.
+  /// @param nb_keys The number of keys.
+  /// @param eq Compare a key with an element.
+  /// @param commit_data For each key, what insert_commit() needs if the key is missing.
+  /// @param results For each key, the result that insert_check() would have given.
+  ///
+  /// The missing keys can then be committed in any order, provided that keys are all different.
+  template <typename T, typename EqT>
+  void
+  insert_check( const T* keys, std::size_t nb_keys, EqT eq, insert_commit_data* commit_data
+              , std::pair<Data*, bool>* results)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    static_assert(not Rehash, "Use with fixed-size hash table only");
+    pipelined(keys, nb_keys, [&](std::size_t i, std::size_t hash)
+    {
+      results[i] = insert_check_impl(keys[i], hash, eq, commit_data[i]);
+    });
+  }
+
+  /// @brief Look for an element equal to a key.
+  /// @param x The key to look for, hashed with std::hash<T>.
+  /// @param eq Compare a key with an element.
+  /// @return The element equal to x, or nullptr if there is none.
+  template <typename T, typename EqT>
+  Data*
+  find(const T& x, EqT eq)
+  const noexcept(noexcept(std::hash<T>()(x)))
+  {
+    return find_if(mixed_hash<Data, Hash>(x), [&](const Data& d){return eq(x, d);});
+  }
+
+  /// @brief Look for several keys at once.
+  /// @param keys The keys to look for.
+  /// @param nb_keys The number of keys.
+  /// @param eq Compare a key with an element.
+  /// @param results For each key, the element equal to it, or nullptr if there is none.
+  template <typename T, typename EqT>
+  void
+  find(const T* keys, std::size_t nb_keys, EqT eq, Data** results)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    pipelined(keys, nb_keys, [&](std::size_t i, std::size_t hash)
+    {
+      const auto& key = keys[i];
+      results[i] = find_if(hash, [&](const Data& d){return eq(key, d);});
+    });
+  }
+
+  void
+  insert_commit(Data* x, insert_commit_data& commit_data)
+  noexcept
+  {
+    static_assert(not Rehash, "Use with fixed-size hash table only");
+    assert(x != nullptr);
+
+    // The table may have been modified since insert_check(), e.g. by the evaluation of a cached
+    // operation or by another commit of a batch. The chosen slot is still valid if it's free and
+    // if slots haven't been reorganized, as the previous groups of its probe sequence can only
+    // have gained deleted slots.
+    if (commit_data.nb_rehash != m_nb_rehash or ctrl_group::is_full(ctrl(commit_data.slot)))
+    {
+      commit_data.slot = find_first_non_full(commit_data.hash);
+    }
+
+    set_hash(*x, commit_data.hash);
+    set_slot(commit_data.slot, h2(commit_data.hash), x);
+    count_insertion(commit_data.slot, commit_data.hash);
+    ++m_size;
+
+    // A fixed-size table never grows, but deleted slots must be reclaimed from time to time to
+    // keep probe sequences short.
+    if (occupied() * 8 > bucket_count() * 7)
+    {
+      drop_deleted();
+    }
+  }
+
+  /// @brief Insert an element.
+  std::pair<Data*, bool>
+  insert(Data* x)
+  {
+    const std::size_t hash = mixed_hash<Data, Hash>(*x);
+    const auto found = find_if(hash, [&](const Data& d){return *x == d;});
+    if (found != nullptr)
+    {
+      return {found, false /* no insertion */};
+    }
+    set_hash(*x, hash);
+    const auto slot = find_first_non_full(hash);
+    set_slot(slot, h2(hash), x);
+    count_insertion(slot, hash);
+    ++m_size;
+    rehash();
+    return {x, true /* insertion */};
+  }
+
+  /// @brief Return the number of elements.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Return the number of slots.
+  std::size_t
+  bucket_count()
+  const noexcept
+  {
+    return m_nb_groups * ctrl_group::width;
+  }
+
+  /// @brief Remove an element given its value.
+  void
+  erase(const Data* x)
+  noexcept
+  {
+    const std::size_t hash = hash_of<Hash>(*x);
+    const auto h = h2(hash);
+    auto g = h1(hash) & (m_nb_groups - 1);
+    for (auto i = 1ul; i <= m_nb_groups; ++i)
+    {
+      const auto& group = m_ctrl[g];
+      for (auto m = group.match(h); m != 0; m &= m - 1)
+      {
+        const auto slot = g * ctrl_group::width + __builtin_ctz(m);
+        if (same_hash(*m_slots[slot], hash) and *x == *m_slots[slot])
+        {
+          // If the group still has an empty slot, no probe sequence went through it, thus the
+          // slot can be marked as empty rather than deleted.
+          if (group.match_empty() != 0)
+          {
+            m_ctrl[g].bytes[slot % ctrl_group::width] = ctrl_group::empty;
+          }
+          else
+          {
+            m_ctrl[g].bytes[slot % ctrl_group::width] = ctrl_group::deleted;
+            ++m_nb_deleted;
+          }
+          if (i != 1) // not in its home group
+          {
+            --m_nb_displaced;
+          }
+          --m_size;
+          if (Rehash and load_factor() < m_min_load_factor)
+          {
+            compact();
+          }
+          return;
+        }
+      }
+      if (group.match_empty() != 0)
+      {
+        break;
+      }
+      g = (g + i) & (m_nb_groups - 1);
+    }
+    assert(false && "Data to erase not found");
+  }
+
+  /// @brief Shrink the slots to fit the number of elements.
+  /// @return true if the table has been shrunk.
+  ///
+  /// The load factor becomes about half of the maximal load factor, so the table won't have to
+  /// grow or shrink again soon. It never goes below the initial number of slots. Nothing
+  /// happens for a fixed-size table or if the new slots can't be allocated.
+  bool
+  compact()
+  noexcept
+  {
+    if (not Rehash)
+    {
+      return false;
+    }
+    auto new_nb_groups = m_min_nb_groups;
+    while (new_nb_groups * ctrl_group::width * m_max_load_factor / 2 < m_size)
+    {
+      new_nb_groups *= 2;
+    }
+    if (new_nb_groups >= m_nb_groups)
+    {
+      return false;
+    }
+    std::unique_ptr<ctrl_group[]> new_ctrl{new (std::nothrow) ctrl_group[new_nb_groups]};
+    std::unique_ptr<Data*[]> new_slots{new (std::nothrow) Data*[new_nb_groups * ctrl_group::width]};
+    if (not new_ctrl or not new_slots)
+    {
+      return false;
+    }
+    ++m_nb_shrink;
+    move_to(std::move(new_ctrl), std::move(new_slots), new_nb_groups);
+    return true;
+  }
+
+  /// @brief Apply a function to all elements.
+  ///
+  /// The table must not be modified by the function.
+  template <typename Function>
+  void
+  for_each(Function&& fun)
+  const
+  {
+    for (auto i = 0ul; i < bucket_count(); ++i)
+    {
+      if (ctrl_group::is_full(ctrl(i)))
+      {
+        fun(*m_slots[i]);
+      }
+    }
+  }
+
+  /// @brief Clear the whole table.
+  template <typename Disposer>
+  void
+  clear_and_dispose(Disposer disposer)
+  {
+    for (auto i = 0ul; i < bucket_count(); ++i)
+    {
+      if (ctrl_group::is_full(ctrl(i)))
+      {
+        disposer(m_slots[i]);
+      }
+    }
+    reset_ctrl(m_ctrl.get(), m_nb_groups);
+    m_size = 0;
+    m_nb_deleted = 0;
+    m_nb_displaced = 0;
+    m_max_chain = 0;
+  }
+
+  /// @brief Get the load factor of the internal hash table.
+  double
+  load_factor()
+  const noexcept
+  {
+    return static_cast<double>(size()) / static_cast<double>(bucket_count());
+  }
+
+  /// @brief The number of times this hash table has been rehashed.
+  std::size_t
+  nb_rehash()
+  const noexcept
+  {
+    return m_nb_rehash;
+  }
+
+  /// @brief The number of times this hash table has been shrunk.
+  std::size_t
+  nb_shrink()
+  const noexcept
+  {
+    return m_nb_shrink;
+  }
+
+  /// @brief The number of collisions.
+  ///
+  /// As there are no buckets, 'collisions' is the number of elements which are not stored in the
+  /// first group of their probe sequence, 'alone' the number of elements which are, and 'empty'
+  /// the number of free slots.
+  std::tuple<std::size_t /* collisions */, std::size_t /* alone */, std::size_t /* empty */>
+  collisions()
+  const noexcept
+  {
+    return std::make_tuple(m_nb_displaced, m_size - m_nb_displaced, bucket_count() - m_size);
+  }
+
+  /// @brief Estimate the number of collisions from a sample of slots.
+  /// @param nb_samples The number of slots to inspect.
+  ///
+  /// Evenly spaced groups are inspected, and the results are scaled to the number of slots. Unlike
+  /// collisions(), it also tells the length, in groups, of the longest probe sequence needed to
+  /// find an inspected element.
+  std::tuple< std::size_t /* collisions */, std::size_t /* alone */, std::size_t /* empty */
+            , std::size_t /* longest chain */>
+  sample_collisions(std::size_t nb_samples)
+  const noexcept
+  {
+    const auto nb_sampled_groups = nb_samples / ctrl_group::width;
+    const auto stride = nb_sampled_groups == 0 or nb_sampled_groups >= m_nb_groups
+                      ? 1ul
+                      : m_nb_groups / nb_sampled_groups;
+    std::size_t col = 0;
+    std::size_t alone = 0;
+    std::size_t empty = 0;
+    std::size_t longest = 0;
+    for (auto g = 0ul; g < m_nb_groups; g += stride)
+    {
+      for (auto i = g * ctrl_group::width; i < (g + 1) * ctrl_group::width; ++i)
+      {
+        if (not ctrl_group::is_full(ctrl(i)))
+        {
+          ++empty;
+          continue;
+        }
+        const auto length = probe_length(i, hash_of<Hash>(*m_slots[i]));
+        if (length == 1) ++alone;
+        else             ++col;
+        longest = std::max(longest, length);
+      }
+    }
+    return std::make_tuple(col * stride, alone * stride, empty * stride, longest);
+  }
+
+  /// @brief The length, in groups, of the longest probe sequence of an insertion since the slots
+  /// were last reallocated or reorganized.
+  std::size_t
+  max_chain()
+  const noexcept
+  {
+    return m_max_chain;
+  }
+
+private:
+
+  /// @brief Compute the number of groups needed to store size elements.
+  static
+  std::size_t
+  nb_groups(std::size_t size)
+  noexcept
+  {
+    const auto nb_slots = next_power_of_2(size);
+    return nb_slots > ctrl_group::width ? nb_slots / ctrl_group::width : 1;
+  }
+
+  static
+  std::size_t
+  h1(std::size_t hash)
+  noexcept
+  {
+    return hash >> 7;
+  }
+
+  static
+  std::int8_t
+  h2(std::size_t hash)
+  noexcept
+  {
+    return static_cast<std::int8_t>(hash & 0x7f);
+  }
+
+  static
+  void
+  reset_ctrl(ctrl_group* ctrl, std::size_t nb_groups)
+  noexcept
+  {
+    std::for_each(ctrl, ctrl + nb_groups, [](ctrl_group& g)
+                                          {
+                                            // Don't bind a reference to ctrl_group::empty.
+                                            const std::int8_t e = ctrl_group::empty;
+                                            std::fill(g.bytes, g.bytes + ctrl_group::width, e);
+                                          });
+  }
+
+  std::int8_t
+  ctrl(std::size_t slot)
+  const noexcept
+  {
+    return m_ctrl[slot / ctrl_group::width].bytes[slot % ctrl_group::width];
+  }
+
+  void
+  set_slot(std::size_t slot, std::int8_t h, Data* x)
+  noexcept
+  {
+    if (ctrl(slot) == ctrl_group::deleted)
+    {
+      --m_nb_deleted;
+    }
+    m_ctrl[slot / ctrl_group::width].bytes[slot % ctrl_group::width] = h;
+    m_slots[slot] = x;
+  }
+
+  /// @brief Call fun(i, hash) for each key of a batched lookup, in order.
+  ///
+  /// The home groups of the next batch are prefetched while a batch is looked up, so the probes
+  /// don't wait for the prefetches issued just before.
+  template <typename T, typename Function>
+  void
+  pipelined(const T* keys, std::size_t nb_keys, Function&& fun)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    const auto nb_batches = (nb_keys + batch_size - 1) / batch_size;
+    std::size_t hashes[2][batch_size];
+    if (nb_batches > 0)
+    {
+      prefetch_groups(keys, nb_keys, 0, hashes[0]);
+    }
+    for (auto b = 0ul; b < nb_batches; ++b)
+    {
+      if (b + 1 < nb_batches)
+      {
+        prefetch_groups(keys, nb_keys, b + 1, hashes[(b + 1) % 2]);
+      }
+      const auto first = b * batch_size;
+      const auto last = std::min(nb_keys, first + batch_size);
+      for (auto i = first; i < last; ++i)
+      {
+        fun(i, hashes[b % 2][i - first]);
+      }
+    }
+  }
+
+  /// @brief Compute the hash values of the keys of a batch and prefetch their home groups.
+  template <typename T>
+  void
+  prefetch_groups(const T* keys, std::size_t nb_keys, std::size_t batch, std::size_t* hashes)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    const auto first = batch * batch_size;
+    const auto last = std::min(nb_keys, first + batch_size);
+    for (auto i = first; i < last; ++i)
+    {
+      hashes[i - first] = mixed_hash<Data, Hash>(keys[i]);
+      const auto g = h1(hashes[i - first]) & (m_nb_groups - 1);
+      prefetch(m_ctrl.get() + g);
+      prefetch(m_slots.get() + g * ctrl_group::width);
+    }
+  }
+
+  template <typename T, typename EqT>
+  std::pair<Data*, bool>
+  insert_check_impl(const T& x, std::size_t hash, EqT eq, insert_commit_data& commit_data)
+  const noexcept
+  {
+    // Always filled, even when x is found, as hash_table does. The first slot of the home group
+    // is only a placeholder, insert_commit() checks it anyway.
+    commit_data.slot = (h1(hash) & (m_nb_groups - 1)) * ctrl_group::width;
+    commit_data.hash = hash;
+    commit_data.nb_rehash = m_nb_rehash;
+    const auto found = find_if(hash, [&](const Data& d){return eq(x, d);});
+    if (found != nullptr)
+    {
+      return {found, false};
+    }
+    commit_data.slot = find_first_non_full(hash);
+    return {nullptr, true};
+  }
+
+  /// @brief The number of groups visited by a probe sequence to reach a slot.
+  std::size_t
+  probe_length(std::size_t slot, std::size_t hash)
+  const noexcept
+  {
+    const auto target = slot / ctrl_group::width;
+    auto g = h1(hash) & (m_nb_groups - 1);
+    auto i = 1ul;
+    for (; g != target; ++i)
+    {
+      assert(i <= m_nb_groups);
+      g = (g + i) & (m_nb_groups - 1);
+    }
+    return i;
+  }
+
+  /// @brief Update the collision counters after an element has been put in a slot.
+  void
+  count_insertion(std::size_t slot, std::size_t hash)
+  noexcept
+  {
+    const auto length = probe_length(slot, hash);
+    if (length != 1)
+    {
+      ++m_nb_displaced;
+    }
+    m_max_chain = std::max(m_max_chain, length);
+  }
+
+  /// @brief The number of slots that are not empty.
+  std::size_t
+  occupied()
+  const noexcept
+  {
+    return m_size + m_nb_deleted;
+  }
+
+  /// @brief Look for a data for which pred is true.
+  template <typename Pred>
+  Data*
+  find_if(std::size_t hash, Pred&& pred)
+  const noexcept(noexcept(pred(std::declval<const Data&>())))
+  {
+    const auto h = h2(hash);
+    auto g = h1(hash) & (m_nb_groups - 1);
+    for (auto i = 1ul; i <= m_nb_groups; ++i)
+    {
+      const auto& group = m_ctrl[g];
+      for (auto m = group.match(h); m != 0; m &= m - 1)
+      {
+        Data* candidate = m_slots[g * ctrl_group::width + __builtin_ctz(m)];
+        if (same_hash(*candidate, hash) and pred(*candidate))
+        {
+          return candidate;
+        }
+      }
+      if (group.match_empty() != 0) // the probe sequence stops at the first non-full group
+      {
+        return nullptr;
+      }
+      g = (g + i) & (m_nb_groups - 1);
+    }
+    return nullptr;
+  }
+
+  /// @brief Get the first empty or deleted slot in the probe sequence of a hash value.
+  std::size_t
+  find_first_non_full(std::size_t hash)
+  const noexcept
+  {
+    auto g = h1(hash) & (m_nb_groups - 1);
+    for (auto i = 1ul; ; ++i)
+    {
+      assert(i <= m_nb_groups && "Full flat_hash_table");
+      const auto m = m_ctrl[g].match_empty_or_deleted();
+      if (m != 0)
+      {
+        return g * ctrl_group::width + __builtin_ctz(m);
+      }
+      g = (g + i) & (m_nb_groups - 1);
+    }
+  }
+
+  void
+  rehash()
+  {
+    if (occupied() < m_max_load_factor * bucket_count()) // no need to rehash
+    {
+      return;
+    }
+    if (load_factor() < m_max_load_factor / 2)
+    {
+      // Mostly deleted slots, reclaim them rather than growing.
+      drop_deleted();
+      return;
+    }
+    ++m_nb_rehash;
+    move_to( std::make_unique<ctrl_group[]>(m_nb_groups * 2)
+           , std::make_unique<Data*[]>(bucket_count() * 2)
+           , m_nb_groups * 2);
+  }
+
+  /// @brief Move all elements to new slots, which become the slots of this table.
+  void
+  move_to( std::unique_ptr<ctrl_group[]> new_ctrl, std::unique_ptr<Data*[]> new_slots
+         , std::size_t new_nb_groups)
+  noexcept
+  {
+    const auto old_nb_slots = bucket_count();
+    auto old_ctrl = std::move(m_ctrl);
+    auto old_slots = std::move(m_slots);
+    m_nb_groups = new_nb_groups;
+    m_ctrl = std::move(new_ctrl);
+    m_slots = std::move(new_slots);
+    reset_ctrl(m_ctrl.get(), m_nb_groups);
+    m_nb_deleted = 0;
+    m_nb_displaced = 0;
+    m_max_chain = 0;
+    for (auto i = 0ul; i < old_nb_slots; ++i)
+    {
+      if (ctrl_group::is_full(old_ctrl[i / ctrl_group::width].bytes[i % ctrl_group::width]))
+      {
+        const std::size_t hash = hash_of<Hash>(*old_slots[i]);
+        const auto slot = find_first_non_full(hash);
+        set_slot(slot, h2(hash), old_slots[i]);
+        count_insertion(slot, hash);
+      }
+    }
+  }
+
+  /// @brief Reclaim all deleted slots, in place.
+  void
+  drop_deleted()
+  noexcept
+  {
+    ++m_nb_rehash;
+    // Mark all full slots as deleted, they will be reinserted, and all deleted slots as empty.
+    for (auto i = 0ul; i < bucket_count(); ++i)
+    {
+      auto& c = m_ctrl[i / ctrl_group::width].bytes[i % ctrl_group::width];
+      c = ctrl_group::is_full(c) ? ctrl_group::deleted : ctrl_group::empty;
+    }
+    for (auto i = 0ul; i < bucket_count(); ++i)
+    {
+      if (ctrl(i) != ctrl_group::deleted) // not an element waiting to be reinserted
+      {
+        continue;
+      }
+      const std::size_t hash = hash_of<Hash>(*m_slots[i]);
+      const auto target = find_first_non_full(hash);
+      auto& c = m_ctrl[i / ctrl_group::width].bytes[i % ctrl_group::width];
+      auto& target_c = m_ctrl[target / ctrl_group::width].bytes[target % ctrl_group::width];
+      if (target / ctrl_group::width == i / ctrl_group::width)
+      {
+        // Already in the right group.
+        c = h2(hash);
+      }
+      else if (target_c == ctrl_group::empty)
+      {
+        target_c = h2(hash);
+        m_slots[target] = m_slots[i];
+        c = ctrl_group::empty;
+      }
+      else
+      {
+        // The target holds an element which has not yet been reinserted: swap and process
+        // the current slot again.
+        target_c = h2(hash);
+        std::swap(m_slots[target], m_slots[i]);
+        --i;
+      }
+    }
+    m_nb_deleted = 0;
+    m_nb_displaced = 0;
+    m_max_chain = 0;
+    for (auto i = 0ul; i < bucket_count(); ++i)
+    {
+      if (ctrl_group::is_full(ctrl(i)))
+      {
+        count_insertion(i, hash_of<Hash>(*m_slots[i]));
+      }
+    }
+  }
+
+private:
+
+  /// @brief The number of groups of slots.
+  std::size_t m_nb_groups;
+
+  /// @brief The initial number of groups, the table never shrinks below.
+  const std::size_t m_min_nb_groups;
+
+  /// @brief
+  std::size_t m_size;
+
+  /// @brief The number of slots marked as deleted.
+  std::size_t m_nb_deleted;
+
+  /// @brief The control bytes, one per slot.
+  std::unique_ptr<ctrl_group[]> m_ctrl;
+
+  /// @brief The stored data.
+  std::unique_ptr<Data*[]> m_slots;
+
+  /// @brief The maximal allowed load factor.
+  const double m_max_load_factor;
+
+  /// @brief The load factor under which the table shrinks.
+  const double m_min_load_factor;
+
+  /// @brief The number of times this hash table has been rehashed.
+  std::size_t m_nb_rehash;
+
+  /// @brief The number of times this hash table has been shrunk.
+  std::size_t m_nb_shrink;
+
+  /// @brief The number of elements which are not in the home group of their probe sequence.
+  std::size_t m_nb_displaced;
+
+  /// @brief The length of the longest probe sequence of an insertion.
+  std::size_t m_max_chain;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
@@ -6,16 +6,19 @@
 
 #pragma once
 
-#include <algorithm>   // fill
+#include <algorithm>   // max, min
 #include <cassert>
 #include <functional>  // hash
 #include <memory>      // unique_ptr
+#include <new>         // nothrow
 #include <tuple>
 #include <type_traits> // enable_if
 #include <utility>     // make_pair, pair
 
+#include "coredd/detail/bucket.hh"
 #include "coredd/detail/intrusive_member_hook.hh"
 #include "coredd/detail/next_power.hh"
+#include "coredd/detail/prefetch.hh"
 #include "coredd/packed.hh"
 
 namespace coredd { namespace detail {
@@ -24,29 +27,95 @@ namespace coredd { namespace detail {
 
 /// @internal
 /// @brief An intrusive hash table.
+/// @tparam Rehash Tell if the table grows when its maximal load factor is reached.
+/// @tparam Incremental Tell if elements are moved to the new buckets a few at a time rather than
+/// all at once when the table grows.
+/// @tparam Front Tell if insert_commit() pushes elements in front of their bucket rather than at
+/// its end.
+/// @tparam Hash The hash policy applied to the values given by std::hash, see identity_mixer.
 ///
 /// It's modeled after boost::intrusive. It uses chaining to handle collisions.
-template <typename Data, bool Rehash = true>
+///
+/// When rehashing incrementally, the old buckets are kept alongside the new ones until all their
+/// elements have been migrated; each insertion or removal migrates a bounded number of buckets.
+/// Thus, the cost of a rehash is spread over subsequent operations instead of stalling one.
+///
+/// A growable table shrinks when its load factor falls under a minimal load factor (never, by
+/// default) or when compact() is called.
+///
+/// The number of empty buckets and of buckets with several elements are maintained on each
+/// insertion and removal, thus collisions() doesn't have to walk the whole table.
+///
+/// insert_commit() doesn't walk the bucket again: insert_check() records the last element of the
+/// bucket, which stays valid as long as the table is not modified in between.
+///
+/// With COREDD_TAGGED_POINTERS, the unused bits of bucket heads summarize the hash values of their
+/// elements, and most lookups of missing elements don't dereference any element (see bucket).
+///
+/// find() and insert_check() also accept several keys at once: the buckets and then the first
+/// elements of the keys are prefetched some batches before they are compared, so the memory
+/// accesses of independent lookups overlap.
+template < typename Data, bool Rehash = true, bool Incremental = false, bool Front = false
+         , typename Hash = identity_mixer>
 class hash_table
 {
+  static_assert(Rehash or not Incremental, "Incremental rehash needs a growable hash table");
+
+  /// @brief The number of old buckets migrated by each insertion or removal.
+  ///
+  /// The table grows when it has 0.75 * 2n elements and n old buckets, so at least 4/3 buckets
+  /// must be migrated by each insertion to be done before the next growth.
+  static constexpr std::size_t migration_step = 4;
+
 public:
 
   /// @brief Used by insert_check
   struct insert_commit_data
   {
-    Data** bucket;
+    detail::bucket<Data>* bucket;
+    /// @brief The last element of the bucket, null if it was empty.
+    Data* last;
+    /// @brief The length of the bucket, or 1 if it's not empty and has not been walked.
+    std::size_t length;
+    /// @brief Tell if the bucket has not been walked, as its summary rejected the key.
+    bool front;
+    std::size_t hash;
+    /// @brief The version of the stripe of the bucket when it was walked.
+    std::size_t version;
   };
 
+  /// @brief The number of keys of a batched lookup which are prefetched together.
+  static constexpr std::size_t batch_size = 8;
+
+  /// @brief The number of stripes of buckets which share a version.
+  ///
+  /// A bucket belongs to the stripe of its position modulo nb_stripes. Each modification of a
+  /// bucket increments the version of its stripe, so a commit only has to walk its bucket again
+  /// when a bucket of the same stripe has been modified since the check.
+  static constexpr std::size_t nb_stripes = 64;
+
 public:
 
-  hash_table(std::size_t size, double max_load_factor = 0.75)
+  hash_table(std::size_t size, double max_load_factor = 0.75, double min_load_factor = 0)
     : m_nb_buckets(next_power_of_2(size))
+    , m_min_nb_buckets(m_nb_buckets)
     , m_size(0)
-    , m_buckets(std::make_unique<Data*[]>(m_nb_buckets))
+    , m_buckets(std::make_unique<bucket<Data>[]>(m_nb_buckets))
     , m_max_load_factor(max_load_factor)
+    , m_min_load_factor(min_load_factor)
     , m_nb_rehash(0)
+    , m_nb_shrink(0)
+    , m_old_nb_buckets(0)
+    , m_old_buckets(nullptr)
+    , m_nb_migrated(0)
+    , m_migration_step(migration_step)
+    , m_nb_used(0)
+    , m_nb_crowded(0)
+    , m_max_chain(0)
+    , m_versions()
   {
-    std::fill(m_buckets.get(), m_buckets.get() + m_nb_buckets, nullptr);
+    assert( (min_load_factor < max_load_factor / 2)
+          && "The table would grow again just after having shrunk");
   }
 
   template <typename T, typename EqT>
@@ -55,22 +124,56 @@ public:
   const noexcept(noexcept(std::hash<T>()(x)))
   {
     static_assert(not Rehash, "Use with fixed-size hash table only");
+    return insert_check_impl(x, mixed_hash<Data, Hash>(x), eq, commit_data);
+  }
 
-    const std::size_t pos = std::hash<T>()(x) & (m_nb_buckets - 1);
+  /// @brief Check the insertion of several keys at once.
+  /// @param keys The keys to check.
+  /// @param nb_keys The number of keys.
+  /// @param eq Compare a key with an element.
+  /// @param commit_data For each key, what insert_commit() needs if the key is missing.
+  /// @param results For each key, the result that insert_check() would have given.
+  ///
+  /// The missing keys can then be committed in any order, provided that keys are all different.
+  template <typename T, typename EqT>
+  void
+  insert_check( const T* keys, std::size_t nb_keys, EqT eq, insert_commit_data* commit_data
+              , std::pair<Data*, bool>* results)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    static_assert(not Rehash, "Use with fixed-size hash table only");
+    pipelined(keys, nb_keys, [&](std::size_t i, std::size_t hash)
+    {
+      results[i] = insert_check_impl(keys[i], hash, eq, commit_data[i]);
+    });
+  }
 
-    Data* current = m_buckets[pos];
-    commit_data.bucket = m_buckets.get() + pos;
+  /// @brief Look for an element equal to a key.
+  /// @param x The key to look for, hashed with std::hash<T>.
+  /// @param eq Compare a key with an element.
+  /// @return The element equal to x, or nullptr if there is none.
+  template <typename T, typename EqT>
+  Data*
+  find(const T& x, EqT eq)
+  const noexcept(noexcept(std::hash<T>()(x)))
+  {
+    return find_impl(x, mixed_hash<Data, Hash>(x), eq);
+  }
 
-    while (current != nullptr)
+  /// @brief Look for several keys at once.
+  /// @param keys The keys to look for.
+  /// @param nb_keys The number of keys.
+  /// @param eq Compare a key with an element.
+  /// @param results For each key, the element equal to it, or nullptr if there is none.
+  template <typename T, typename EqT>
+  void
+  find(const T* keys, std::size_t nb_keys, EqT eq, Data** results)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    pipelined(keys, nb_keys, [&](std::size_t i, std::size_t hash)
     {
-      if (eq(x, *current))
-      {
-        return {current, false};
-      }
-      current = current->hook().next;
-    }
-
-    return {current, true};
+      results[i] = find_impl(keys[i], hash, eq);
+    });
   }
 
   void
@@ -80,26 +183,42 @@ public:
     static_assert(not Rehash, "Use with fixed-size hash table only");
     assert(x != nullptr);
 
-    Data* previous = nullptr;
-    Data* current = *commit_data.bucket;
-
-    // We append x at the end of the bucket, it seems to be faster than appending it directly
-    // in front.
-    while (current != nullptr)
-    {
-      previous = current;
-      current = current->hook().next;
-    }
+    set_hash(*x, commit_data.hash);
+    auto& b = *commit_data.bucket;
+    count_push(b.head());
 
-    if (previous != nullptr)
+    if (Front or commit_data.front)
     {
-      previous->hook().next = x;
+      b.push_front(x, commit_data.hash);
     }
     else
     {
-      *commit_data.bucket = x;
+      if (commit_data.version != m_versions[stripe(commit_data.hash)])
+      {
+        // The bucket may have changed since insert_check() (e.g. an entry has been evicted or a
+        // nested operation has been cached), walk it again. Other buckets may have changed, as
+        // when a full cache discards an entry, without invalidating commit_data.last.
+        commit_data.last = nullptr;
+        commit_data.length = 0;
+        for (Data* current = b.head(); current != nullptr; current = current->hook().next)
+        {
+          commit_data.last = current;
+          ++commit_data.length;
+        }
+      }
+      if (commit_data.last != nullptr)
+      {
+        commit_data.last->hook().next = x;
+      }
+      else
+      {
+        b.set_head(x);
+      }
+      b.add(commit_data.hash);
     }
+    m_max_chain = std::max(m_max_chain, commit_data.length + 1);
 
+    ++m_versions[stripe(commit_data.hash)];
     ++m_size;
   }
 
@@ -107,7 +226,13 @@ public:
   std::pair<Data*, bool>
   insert(Data* x)
   {
-    auto res = insert_impl(x, m_buckets.get(), m_nb_buckets);
+    const std::size_t hash = mixed_hash<Data, Hash>(*x);
+    // While the old bucket of x is not migrated, x goes there, so an element is always in the
+    // old bucket of its hash value if it's not migrated, and in its new bucket otherwise.
+    const bool old = Incremental and migrating()
+                 and (hash & (m_old_nb_buckets - 1)) >= m_nb_migrated;
+    auto res = old ? insert_impl(x, hash, m_old_buckets.get(), m_old_nb_buckets)
+                   : insert_impl(x, hash, m_buckets.get(), m_nb_buckets);
     rehash();
     return res;
   }
@@ -133,28 +258,97 @@ public:
   erase(const Data* x)
   noexcept
   {
-    const std::size_t pos = std::hash<Data>()(*x) & (m_nb_buckets - 1);
-    Data* previous = nullptr;
-    Data* current = m_buckets[pos];
-    while (current != nullptr)
+    const std::size_t hash = hash_of<Hash>(*x);
+    if (Incremental and migrating())
     {
-      if (*x == *current)
+      const std::size_t old_pos = hash & (m_old_nb_buckets - 1);
+      if (old_pos >= m_nb_migrated) // x is still in the old buckets
       {
-        if (previous == nullptr) // first element in bucket
-        {
-          m_buckets[pos] = current->hook().next;
-        }
-        else
+        erase_impl(x, hash, m_old_buckets[old_pos]);
+      }
+      else
+      {
+        erase_impl(x, hash, m_buckets[hash & (m_nb_buckets - 1)]);
+      }
+      migrate(m_migration_step);
+    }
+    else
+    {
+      erase_impl(x, hash, m_buckets[hash & (m_nb_buckets - 1)]);
+    }
+    if (Rehash and load_factor() < m_min_load_factor)
+    {
+      if (Incremental)
+      {
+        // Don't pause to move all elements, as when growing.
+        start_shrink();
+      }
+      else
+      {
+        compact();
+      }
+    }
+  }
+
+  /// @brief Shrink the buckets to fit the number of elements.
+  /// @return true if the table has been shrunk.
+  ///
+  /// The load factor becomes about half of the maximal load factor, so the table won't have to
+  /// grow or shrink again soon. It never goes below the initial number of buckets. Nothing
+  /// happens for a fixed-size table or if the new buckets can't be allocated.
+  bool
+  compact()
+  noexcept
+  {
+    if (not Rehash)
+    {
+      return false;
+    }
+    if (Incremental)
+    {
+      migrate(m_old_nb_buckets);
+    }
+    const auto new_nb_buckets = shrunk_nb_buckets();
+    if (new_nb_buckets >= m_nb_buckets)
+    {
+      return false;
+    }
+    std::unique_ptr<bucket<Data>[]> new_buckets{new (std::nothrow) bucket<Data>[new_nb_buckets]};
+    if (not new_buckets)
+    {
+      return false;
+    }
+    ++m_nb_shrink;
+    move_to(std::move(new_buckets), new_nb_buckets);
+    return true;
+  }
+
+  /// @brief Apply a function to all elements.
+  ///
+  /// The table must not be modified by the function.
+  template <typename Function>
+  void
+  for_each(Function&& fun)
+  const
+  {
+    for (auto i = 0ul; i < m_nb_buckets; ++i)
+    {
+      for (Data* current = m_buckets[i].head(); current != nullptr; current = current->hook().next)
+      {
+        fun(*current);
+      }
+    }
+    if (Incremental and migrating())
+    {
+      for (auto i = m_nb_migrated; i < m_old_nb_buckets; ++i)
+      {
+        for (Data* current = m_old_buckets[i].head(); current != nullptr;
+             current = current->hook().next)
         {
-          previous->hook().next = current->hook().next;
+          fun(*current);
         }
-        --m_size;
-        return;
       }
-      previous = current;
-      current = current->hook().next;
     }
-    assert(false && "Data to erase not found");
   }
 
   /// @brief Clear the whole table.
@@ -164,14 +358,32 @@ public:
   {
     for (auto i = 0ul; i < m_nb_buckets; ++i)
     {
-      Data* current = m_buckets[i];
+      Data* current = m_buckets[i].head();
       while (current != nullptr)
       {
         const auto to_erase = current;
         current = current->hook().next;
         disposer(to_erase);
       }
-      m_buckets[i] = nullptr;
+      m_buckets[i].set_head(nullptr);
+    }
+    m_nb_used = 0;
+    m_nb_crowded = 0;
+    m_max_chain = 0;
+    touch_all();
+    if (Incremental and migrating())
+    {
+      for (auto i = m_nb_migrated; i < m_old_nb_buckets; ++i)
+      {
+        Data* current = m_old_buckets[i].head();
+        while (current != nullptr)
+        {
+          const auto to_erase = current;
+          current = current->hook().next;
+          disposer(to_erase);
+        }
+      }
+      end_migration();
     }
     m_size = 0;
   }
@@ -192,102 +404,543 @@ public:
     return m_nb_rehash;
   }
 
+  /// @brief The number of times this hash table has been shrunk.
+  std::size_t
+  nb_shrink()
+  const noexcept
+  {
+    return m_nb_shrink;
+  }
+
+  /// @brief Tell if an incremental rehash is in progress.
+  bool
+  migrating()
+  const noexcept
+  {
+    return m_old_buckets != nullptr;
+  }
+
   /// @brief The number of collisions.
+  ///
+  /// Old buckets which are not migrated yet are taken into account.
   std::tuple<std::size_t /* collisions */, std::size_t /* alone */, std::size_t /* empty */>
   collisions()
   const noexcept
   {
+    const auto nb_buckets = m_nb_buckets + (m_old_nb_buckets - m_nb_migrated);
+    return std::make_tuple(m_nb_crowded, m_nb_used - m_nb_crowded, nb_buckets - m_nb_used);
+  }
+
+  /// @brief Estimate the number of collisions from a sample of buckets.
+  /// @param nb_samples The number of buckets to inspect.
+  ///
+  /// Evenly spaced buckets are inspected, and the results are scaled to the number of buckets.
+  /// Unlike collisions(), it also tells the length of the longest inspected chain. Old buckets
+  /// which are not migrated yet are ignored.
+  std::tuple< std::size_t /* collisions */, std::size_t /* alone */, std::size_t /* empty */
+            , std::size_t /* longest chain */>
+  sample_collisions(std::size_t nb_samples)
+  const noexcept
+  {
+    const auto stride = nb_samples == 0 or nb_samples >= m_nb_buckets
+                      ? 1ul
+                      : m_nb_buckets / nb_samples;
     std::size_t col = 0;
     std::size_t alone = 0;
     std::size_t empty = 0;
-    for (auto i = 0ul; i <m_nb_buckets; ++i)
+    std::size_t longest = 0;
+    for (auto i = 0ul; i < m_nb_buckets; i += stride)
     {
       std::size_t nb = 0;
-      auto current = m_buckets[i];
-      while (current != nullptr)
+      for (Data* current = m_buckets[i].head(); current != nullptr; current = current->hook().next)
       {
         ++nb;
-        current = current->hook().next;
       }
       if      (nb == 0) ++empty;
       else if (nb == 1) ++alone;
-      else if (nb > 1)  ++col;
+      else              ++col;
+      longest = std::max(longest, nb);
     }
-    return std::make_tuple(col, alone, empty);
+    return std::make_tuple(col * stride, alone * stride, empty * stride, longest);
+  }
+
+  /// @brief The length of the longest chain met by an insertion since the buckets were last
+  /// reallocated.
+  ///
+  /// With summarized buckets (see bucket), an insertion rejected by the summary doesn't walk the
+  /// chain, which is then counted as the new element and the first one only: it's a lower bound.
+  /// Long chains are still likely to be met, as they summarize many hash values and let most
+  /// insertions through. sample_collisions() gives the exact length of the sampled chains.
+  std::size_t
+  max_chain()
+  const noexcept
+  {
+    return m_max_chain;
   }
 
 private:
 
+  /// @brief Call fun(i, hash) for each key of a batched lookup, in order.
+  ///
+  /// Keys are processed by batches, as a software pipeline: while a batch is looked up, the first
+  /// elements of the next batch are prefetched, their buckets having been prefetched one batch
+  /// earlier, and the buckets of the batch after are prefetched. Thus, reading the head of a
+  /// bucket doesn't wait for the prefetch issued just before.
+  template <typename T, typename Function>
+  void
+  pipelined(const T* keys, std::size_t nb_keys, Function&& fun)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    const auto nb_batches = (nb_keys + batch_size - 1) / batch_size;
+    std::size_t hashes[3][batch_size];
+    for (auto b = 0ul; b < 2 and b < nb_batches; ++b)
+    {
+      prefetch_buckets(keys, nb_keys, b, hashes[b]);
+    }
+    if (nb_batches > 0)
+    {
+      prefetch_heads(nb_keys, 0, hashes[0]);
+    }
+    for (auto b = 0ul; b < nb_batches; ++b)
+    {
+      if (b + 2 < nb_batches)
+      {
+        prefetch_buckets(keys, nb_keys, b + 2, hashes[(b + 2) % 3]);
+      }
+      if (b + 1 < nb_batches)
+      {
+        prefetch_heads(nb_keys, b + 1, hashes[(b + 1) % 3]);
+      }
+      const auto first = b * batch_size;
+      const auto last = std::min(nb_keys, first + batch_size);
+      for (auto i = first; i < last; ++i)
+      {
+        fun(i, hashes[b % 3][i - first]);
+      }
+    }
+  }
+
+  /// @brief Compute the hash values of the keys of a batch and prefetch their buckets.
+  template <typename T>
+  void
+  prefetch_buckets(const T* keys, std::size_t nb_keys, std::size_t batch, std::size_t* hashes)
+  const noexcept(noexcept(std::hash<T>()(*keys)))
+  {
+    const auto first = batch * batch_size;
+    const auto last = std::min(nb_keys, first + batch_size);
+    for (auto i = first; i < last; ++i)
+    {
+      hashes[i - first] = mixed_hash<Data, Hash>(keys[i]);
+      prefetch(m_buckets.get() + (hashes[i - first] & (m_nb_buckets - 1)));
+    }
+  }
+
+  /// @brief Prefetch the first elements of the buckets of a batch, previously prefetched.
+  void
+  prefetch_heads(std::size_t nb_keys, std::size_t batch, const std::size_t* hashes)
+  const noexcept
+  {
+    const auto first = batch * batch_size;
+    const auto last = std::min(nb_keys, first + batch_size);
+    for (auto i = first; i < last; ++i)
+    {
+      prefetch(m_buckets[hashes[i - first] & (m_nb_buckets - 1)].head());
+    }
+  }
+
+  template <typename T, typename EqT>
+  std::pair<Data*, bool>
+  insert_check_impl(const T& x, std::size_t hash, EqT eq, insert_commit_data& commit_data)
+  const noexcept
+  {
+    const std::size_t pos = hash & (m_nb_buckets - 1);
+
+    commit_data.bucket = m_buckets.get() + pos;
+    commit_data.last = nullptr;
+    commit_data.length = 0;
+    commit_data.front = false;
+    commit_data.hash = hash;
+    commit_data.version = m_versions[stripe(hash)];
+    if (not m_buckets[pos].may_contain(hash))
+    {
+      commit_data.front = true;
+      // The chain is not walked, only its first element is known.
+      commit_data.length = m_buckets[pos].head() != nullptr ? 1 : 0;
+      return {nullptr, true};
+    }
+
+    Data* current = m_buckets[pos].head();
+
+    while (current != nullptr)
+    {
+      if (same_hash(*current, hash) and eq(x, *current))
+      {
+        return {current, false};
+      }
+      commit_data.last = current;
+      ++commit_data.length;
+      current = current->hook().next;
+    }
+
+    return {current, true};
+  }
+
+  /// @brief Look for an element equal to a key, in the old buckets too.
+  template <typename T, typename EqT>
+  Data*
+  find_impl(const T& x, std::size_t hash, EqT eq)
+  const noexcept
+  {
+    const auto& b = m_buckets[hash & (m_nb_buckets - 1)];
+    if (b.may_contain(hash))
+    {
+      for (Data* current = b.head(); current != nullptr; current = current->hook().next)
+      {
+        if (same_hash(*current, hash) and eq(x, *current))
+        {
+          return current;
+        }
+      }
+    }
+    if (Incremental and migrating())
+    {
+      const std::size_t old_pos = hash & (m_old_nb_buckets - 1);
+      if (old_pos >= m_nb_migrated and m_old_buckets[old_pos].may_contain(hash))
+      {
+        for (Data* current = m_old_buckets[old_pos].head(); current != nullptr;
+             current = current->hook().next)
+        {
+          if (same_hash(*current, hash) and eq(x, *current))
+          {
+            return current;
+          }
+        }
+      }
+    }
+    return nullptr;
+  }
+
   void
   rehash()
   {
+    if (Incremental and migrating())
+    {
+      migrate(m_migration_step);
+    }
     if (load_factor() < m_max_load_factor) // no need to rehash
     {
       return;
     }
     ++m_nb_rehash;
-    auto new_nb_buckets = m_nb_buckets * 2;
-    auto new_buckets = new Data*[new_nb_buckets];
-    std::fill(new_buckets, new_buckets + new_nb_buckets, nullptr);
-    m_size = 0;
+    if (Incremental)
+    {
+      start_migration( std::make_unique<bucket<Data>[]>(m_nb_buckets * 2), m_nb_buckets * 2
+                     , migration_step);
+      return;
+    }
+    move_to(std::make_unique<bucket<Data>[]>(m_nb_buckets * 2), m_nb_buckets * 2);
+  }
+
+  /// @brief Move all elements to new buckets, which become the buckets of this table.
+  void
+  move_to(std::unique_ptr<bucket<Data>[]> new_buckets, std::size_t new_nb_buckets)
+  noexcept
+  {
+    touch_all();
+    m_nb_used = 0;
+    m_nb_crowded = 0;
+    m_max_chain = 0;
     for (auto i = 0ul; i < m_nb_buckets; ++i)
     {
-      Data* data_ptr = m_buckets[i];
+      Data* data_ptr = m_buckets[i].head();
       while (data_ptr)
       {
         Data* next = data_ptr->hook().next;
-        data_ptr->hook().next = nullptr;
-        insert_impl(data_ptr, new_buckets, new_nb_buckets);
+        const std::size_t hash = hash_of<Hash>(*data_ptr);
+        const std::size_t pos = hash & (new_nb_buckets - 1);
+        count_push(new_buckets[pos].head());
+        new_buckets[pos].push_front(data_ptr, hash);
         data_ptr = next;
       }
       // else empty bucket
     }
-    m_buckets.reset(new_buckets);
+    m_buckets = std::move(new_buckets);
     m_nb_buckets = new_nb_buckets;
   }
 
-  /// @brief Insert an element.
-  std::pair<Data*, bool>
-  insert_impl(Data* x, Data** buckets, std::size_t nb_buckets)
-  noexcept(noexcept(std::hash<Data>()(*x)))
+  /// @brief The number of buckets of the table shrunk to fit its elements, see compact().
+  std::size_t
+  shrunk_nb_buckets()
+  const noexcept
+  {
+    auto nb_buckets = m_min_nb_buckets;
+    while (nb_buckets * m_max_load_factor / 2 < m_size)
+    {
+      nb_buckets *= 2;
+    }
+    return nb_buckets;
+  }
+
+  /// @brief Shrink the table incrementally, as it grows.
+  ///
+  /// The old buckets are mostly empty, so more of them are migrated at once: the migration is
+  /// over after a quarter of the elements at most have been removed, reading about
+  /// 4 / min_load_factor buckets per operation. Nothing happens during a migration, the next
+  /// erasures will check the load factor again.
+  void
+  start_shrink()
+  noexcept
   {
-    const std::size_t pos = std::hash<Data>()(*x) & (nb_buckets - 1);
+    if (migrating())
+    {
+      return;
+    }
+    const auto new_nb_buckets = shrunk_nb_buckets();
+    if (new_nb_buckets >= m_nb_buckets)
+    {
+      return;
+    }
+    std::unique_ptr<bucket<Data>[]> new_buckets{new (std::nothrow) bucket<Data>[new_nb_buckets]};
+    if (new_buckets)
+    {
+      ++m_nb_shrink;
+      const auto step = 4 * m_nb_buckets / (m_size + 1);
+      start_migration( std::move(new_buckets), new_nb_buckets
+                     , step > migration_step ? step : migration_step);
+    }
+  }
 
-    Data* current = buckets[pos];
+  /// @brief Install new buckets and keep the old ones until all their elements are migrated.
+  /// @param step The number of old buckets migrated by each insertion or removal.
+  void
+  start_migration( std::unique_ptr<bucket<Data>[]> new_buckets, std::size_t new_nb_buckets
+                 , std::size_t step)
+  noexcept
+  {
+    // A previous migration should be over, but finish it if the table grew faster than expected.
+    migrate(m_old_nb_buckets);
+    m_old_buckets = std::move(m_buckets);
+    m_old_nb_buckets = m_nb_buckets;
+    m_nb_migrated = 0;
+    m_migration_step = step;
+    m_buckets = std::move(new_buckets);
+    m_nb_buckets = new_nb_buckets;
+    m_max_chain = 0;
+  }
 
+  /// @brief Move the elements of at most nb old buckets to the new buckets.
+  void
+  migrate(std::size_t nb)
+  noexcept
+  {
+    if (not migrating())
+    {
+      return;
+    }
+    const auto last = m_old_nb_buckets - m_nb_migrated > nb ? m_nb_migrated + nb : m_old_nb_buckets;
+    for (; m_nb_migrated < last; ++m_nb_migrated)
+    {
+      Data* data_ptr = m_old_buckets[m_nb_migrated].head();
+      if (data_ptr != nullptr)
+      {
+        --m_nb_used;
+        if (data_ptr->hook().next != nullptr)
+        {
+          --m_nb_crowded;
+        }
+      }
+      while (data_ptr)
+      {
+        Data* next = data_ptr->hook().next;
+        const std::size_t hash = hash_of<Hash>(*data_ptr);
+        const std::size_t pos = hash & (m_nb_buckets - 1);
+        count_push(m_buckets[pos].head());
+        m_buckets[pos].push_front(data_ptr, hash);
+        data_ptr = next;
+      }
+    }
+    if (m_nb_migrated == m_old_nb_buckets)
+    {
+      end_migration();
+    }
+  }
+
+  /// @brief Release the old buckets.
+  void
+  end_migration()
+  noexcept
+  {
+    m_old_buckets.reset();
+    m_old_nb_buckets = 0;
+    m_nb_migrated = 0;
+  }
+
+  /// @brief Remove an element from a bucket.
+  void
+  erase_impl(const Data* x, std::size_t hash, bucket<Data>& b)
+  noexcept
+  {
+    Data* previous = nullptr;
+    Data* current = b.head();
     while (current != nullptr)
     {
-      if (*x == *current)
+      if (same_hash(*current, hash) and *x == *current)
       {
-        return {current, false /* no insertion */};
+        if (previous == nullptr) // first element in bucket
+        {
+          b.set_head(current->hook().next);
+        }
+        else
+        {
+          previous->hook().next = current->hook().next;
+        }
+        count_pop(b.head());
+        ++m_versions[stripe(hash)];
+        --m_size;
+        return;
       }
+      previous = current;
       current = current->hook().next;
     }
+    assert(false && "Data to erase not found");
+  }
+
+  /// @brief Insert an element.
+  std::pair<Data*, bool>
+  insert_impl(Data* x, std::size_t hash, bucket<Data>* buckets, std::size_t nb_buckets)
+  noexcept
+  {
+    auto& b = buckets[hash & (nb_buckets - 1)];
+    std::size_t length = 1;
+
+    if (b.may_contain(hash))
+    {
+      for (Data* current = b.head(); current != nullptr; current = current->hook().next)
+      {
+        if (same_hash(*current, hash) and *x == *current)
+        {
+          return {current, false /* no insertion */};
+        }
+        ++length;
+      }
+    }
+    else if (b.head() != nullptr)
+    {
+      // The chain is not walked, only its first element is known.
+      length = 2;
+    }
+    m_max_chain = std::max(m_max_chain, length);
 
     // Push in front of the list.
-    x->hook().next = buckets[pos];
-    buckets[pos] = x;
+    set_hash(*x, hash);
+    count_push(b.head());
+    b.push_front(x, hash);
+    ++m_versions[stripe(hash)];
 
     ++m_size;
     return {x, true /* insertion */};
   }
 
+  /// @brief The stripe of the bucket of a hash value.
+  ///
+  /// Only stripes of fixed-size tables matter, as commits are not possible with the others.
+  std::size_t
+  stripe(std::size_t hash)
+  const noexcept
+  {
+    return hash & (m_nb_buckets - 1) & (nb_stripes - 1);
+  }
+
+  /// @brief Invalidate the pending commits of all buckets.
+  void
+  touch_all()
+  noexcept
+  {
+    for (auto& version : m_versions)
+    {
+      ++version;
+    }
+  }
+
+  /// @brief Update the bucket counters before an element is added to a bucket.
+  void
+  count_push(Data* head)
+  noexcept
+  {
+    if (head == nullptr)
+    {
+      ++m_nb_used;
+    }
+    else if (head->hook().next == nullptr)
+    {
+      ++m_nb_crowded;
+    }
+  }
+
+  /// @brief Update the bucket counters after an element has been removed from a bucket.
+  void
+  count_pop(Data* head)
+  noexcept
+  {
+    if (head == nullptr)
+    {
+      --m_nb_used;
+    }
+    else if (head->hook().next == nullptr)
+    {
+      --m_nb_crowded;
+    }
+  }
+
 private:
 
   /// @brief
   std::size_t m_nb_buckets;
 
+  /// @brief The initial number of buckets, the table never shrinks below.
+  const std::size_t m_min_nb_buckets;
+
   /// @brief
   std::size_t m_size;
 
   /// @brief
-  std::unique_ptr<Data*[]> m_buckets;
+  std::unique_ptr<bucket<Data>[]> m_buckets;
 
   /// @brief The maximal allowed load factor.
   const double m_max_load_factor;
 
+  /// @brief The load factor under which the table shrinks.
+  const double m_min_load_factor;
+
   /// @brief The number of times this hash table has been rehashed.
   std::size_t m_nb_rehash;
+
+  /// @brief The number of times this hash table has been shrunk.
+  std::size_t m_nb_shrink;
+
+  /// @brief The number of buckets before the current incremental rehash.
+  std::size_t m_old_nb_buckets;
+
+  /// @brief The buckets before the current incremental rehash, null when there is none.
+  std::unique_ptr<bucket<Data>[]> m_old_buckets;
+
+  /// @brief The number of old buckets already migrated to the new buckets.
+  std::size_t m_nb_migrated;
+
+  /// @brief The number of old buckets migrated by each insertion or removal.
+  std::size_t m_migration_step;
+
+  /// @brief The number of non-empty buckets, old ones included.
+  std::size_t m_nb_used;
+
+  /// @brief The number of buckets with more than one element, old ones included.
+  std::size_t m_nb_crowded;
+
+  /// @brief The length of the longest chain met by an insertion.
+  std::size_t m_max_chain;
+
+  /// @brief For each stripe, incremented by each modification of one of its buckets.
+  std::size_t m_versions[nb_stripes];
 };
 
 /*------------------------------------------------------------------------------------------------*/
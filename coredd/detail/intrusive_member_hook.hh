@@ -6,6 +6,14 @@
 
 #pragma once
 
+#include <cstdint>     // uint32_t
+#include <functional>  // hash
+#include <type_traits> // conditional, decay, enable_if, false_type, is_same
+#include <utility>     // declval
+
+#include "coredd/hash.hh"
+#include "coredd/packed.hh"
+
 namespace coredd { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
@@ -20,4 +28,172 @@ struct intrusive_member_hook
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief A hook which also keeps the hash value of the data.
+///
+/// Hash tables then never recompute hash values when rehashing or erasing, and only compare data
+/// which have the same hash value. In packed mode, only 32 bits of the hash value are kept, and
+/// hash tables place all data and keys with these bits only (see mixed_hash()): a table then uses
+/// at most 2^32 buckets, or 2^25 groups for flat_hash_table.
+template <typename Data>
+struct COREDD_ATTRIBUTE_PACKED hashed_member_hook
+{
+  /// @brief Store the next data in a bucket.
+  mutable Data* next = nullptr;
+
+  /// @brief The hash value of the data.
+#ifdef COREDD_PACKED
+  std::uint32_t hash = 0;
+#else
+  std::size_t hash = 0;
+#endif
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Select the type of hook of a data.
+template <typename Data, bool StoreHash>
+using member_hook = std::conditional_t< StoreHash
+                                      , hashed_member_hook<Data>
+                                      , intrusive_member_hook<Data>>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Tell if a data stores its hash value in its hook.
+///
+/// Base case: the data has no hook.
+template <typename Data, typename = void>
+struct stores_hash
+  : std::false_type
+{};
+
+/// @internal
+/// @brief Tell if a data stores its hash value in its hook.
+template <typename Data>
+struct stores_hash<Data, decltype(void(std::declval<Data&>().hook()))>
+  : std::is_same< std::decay_t<decltype(std::declval<Data&>().hook())>
+                , hashed_member_hook<Data>>
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Truncate a hash value to what the hook of a data keeps.
+///
+/// Base case: the whole hash value is used.
+template <typename Data>
+inline
+std::enable_if_t<not stores_hash<Data>::value, std::size_t>
+truncate_hash(std::size_t hash)
+noexcept
+{
+  return hash;
+}
+
+/// @internal
+/// @brief Truncate a hash value to what the hook of a data keeps.
+///
+/// In packed mode, hashed_member_hook only keeps 32 bits.
+template <typename Data>
+inline
+std::enable_if_t<stores_hash<Data>::value, std::size_t>
+truncate_hash(std::size_t hash)
+noexcept
+{
+  return static_cast<decltype(std::declval<const Data&>().hook().hash)>(hash);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Compute the hash value used by a hash table of Data to place a key.
+/// @tparam Hash The hash policy of the hash table.
+///
+/// It's truncated as the hooks of the data of the table keep it, so that the position of a data
+/// computed from its key and from its hook (see hash_of()) are always the same.
+template <typename Data, typename Hash, typename T>
+inline
+std::size_t
+mixed_hash(const T& x)
+noexcept(noexcept(std::hash<T>()(x)))
+{
+  return truncate_hash<Data>(Hash{}(std::hash<T>()(x)));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Get the hash value of a data which is stored in a hash table.
+/// @tparam Hash The hash policy of the hash table.
+template <typename Hash = identity_mixer, typename Data>
+inline
+std::enable_if_t<not stores_hash<Data>::value, std::size_t>
+hash_of(const Data& x)
+noexcept(noexcept(std::hash<Data>()(x)))
+{
+  return Hash{}(std::hash<Data>()(x));
+}
+
+/// @internal
+/// @brief Get the hash value of a data which is stored in a hash table.
+///
+/// The stored hash value has already been mixed by the hash policy of the hash table.
+template <typename Hash = identity_mixer, typename Data>
+inline
+std::enable_if_t<stores_hash<Data>::value, std::size_t>
+hash_of(const Data& x)
+noexcept
+{
+  return x.hook().hash;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Keep the hash value of a data when it's inserted in a hash table, if possible.
+template <typename Data>
+inline
+std::enable_if_t<not stores_hash<Data>::value>
+set_hash(Data&, std::size_t)
+noexcept
+{}
+
+/// @internal
+/// @brief Keep the hash value of a data when it's inserted in a hash table, if possible.
+template <typename Data>
+inline
+std::enable_if_t<stores_hash<Data>::value>
+set_hash(Data& x, std::size_t hash)
+noexcept
+{
+  x.hook().hash = hash;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Tell if a data stored in a hash table may be equal to a data with the given hash value.
+template <typename Data>
+inline
+std::enable_if_t<not stores_hash<Data>::value, bool>
+same_hash(const Data&, std::size_t)
+noexcept
+{
+  return true;
+}
+
+/// @internal
+/// @brief Tell if a data stored in a hash table may be equal to a data with the given hash value.
+template <typename Data>
+inline
+std::enable_if_t<stores_hash<Data>::value, bool>
+same_hash(const Data& x, std::size_t hash)
+noexcept
+{
+  return x.hook().hash == static_cast<decltype(x.hook().hash)>(hash);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace coredd::detail
@@ -6,16 +6,164 @@
 
 #pragma once
 
-#include <list>
+#include <cassert>
+#include <cstddef> // size_t
+
+#include "coredd/detail/prefetch.hh"
 
 namespace coredd { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @internal
-/// @brief The type of the container that sorts cache entries by last access date.
-template <typename CacheEntry>
-using lru_list = std::list<CacheEntry*>;
+/// @brief The links of an element of an lru_list, embedded in this element.
+template <typename T>
+struct lru_hook
+{
+  /// @brief The previous element, less recently used.
+  T* prev = nullptr;
+
+  /// @brief The next element, more recently used.
+  T* next = nullptr;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The container that sorts cache entries by last access date, to evict the least recently
+/// used one.
+///
+/// It's an intrusive doubly-linked list: elements give access to their links with
+/// eviction_hook(), so inserting an element doesn't allocate, and moving it to the back only
+/// touches this element and its neighbours. The front is the least recently used element.
+template <typename T>
+class lru_list
+{
+  // Can't copy an lru_list.
+  lru_list(const lru_list&) = delete;
+  lru_list& operator=(const lru_list&) = delete;
+
+public:
+
+  /// @brief The links embedded in elements.
+  using hook_type = lru_hook<T>;
+
+  /// @brief Constructor, the number of elements doesn't need to be known.
+  explicit
+  lru_list(std::size_t = 0)
+  noexcept
+    : m_front(nullptr), m_back(nullptr)
+  {}
+
+  bool
+  empty()
+  const noexcept
+  {
+    return m_front == nullptr;
+  }
+
+  /// @brief Nothing to do, links are in elements.
+  void
+  reserve(std::size_t)
+  noexcept
+  {}
+
+  /// @brief Get the least recently used element.
+  T*
+  front()
+  const noexcept
+  {
+    assert(not empty());
+    return m_front;
+  }
+
+  /// @brief Insert an element as the most recently used one.
+  void
+  insert(T* x)
+  noexcept
+  {
+    auto& hook = x->eviction_hook();
+    hook.prev = m_back;
+    hook.next = nullptr;
+    if (m_back == nullptr)
+    {
+      m_front = x;
+    }
+    else
+    {
+      m_back->eviction_hook().next = x;
+    }
+    m_back = x;
+  }
+
+  /// @brief Remove and get the least recently used element.
+  ///
+  /// The next one is prefetched, as several elements are often evicted in a row.
+  T*
+  evict()
+  noexcept
+  {
+    auto* x = front();
+    erase(x);
+    prefetch(m_front);
+    return x;
+  }
+
+  /// @brief Remove an element.
+  void
+  erase(T* x)
+  noexcept
+  {
+    auto& hook = x->eviction_hook();
+    if (hook.prev == nullptr)
+    {
+      assert(m_front == x);
+      m_front = hook.next;
+    }
+    else
+    {
+      hook.prev->eviction_hook().next = hook.next;
+    }
+    if (hook.next == nullptr)
+    {
+      assert(m_back == x);
+      m_back = hook.prev;
+    }
+    else
+    {
+      hook.next->eviction_hook().prev = hook.prev;
+    }
+  }
+
+  /// @brief Make an element the most recently used one.
+  void
+  touch(T* x)
+  noexcept
+  {
+    if (x != m_back)
+    {
+      erase(x);
+      insert(x);
+    }
+  }
+
+  /// @brief Forget all elements, which are not modified.
+  void
+  clear()
+  noexcept
+  {
+    m_front = nullptr;
+    m_back = nullptr;
+  }
+
+private:
+
+  /// @brief The least recently used element.
+  T* m_front;
+
+  /// @brief The most recently used element.
+  T* m_back;
+};
 
 /*------------------------------------------------------------------------------------------------*/
 
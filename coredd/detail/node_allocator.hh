@@ -0,0 +1,542 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <cassert>
+#include <cstddef> // max_align_t, size_t
+#include <cstdint> // uint32_t, uintptr_t
+#include <cstdlib> // free
+#include <memory>  // make_unique, unique_ptr
+#include <new>     // bad_alloc
+
+#if defined __unix__ || defined __APPLE__
+#  include <stdlib.h> // posix_memalign
+#  define COREDD_HAS_POSIX_MEMALIGN
+#endif
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The statistics of an allocator of unified data.
+struct allocator_statistics
+{
+  /// @brief The number of bytes of blocks given to unified data.
+  std::size_t used;
+
+  /// @brief The number of bytes kept by the allocator which are not used by any unified data.
+  std::size_t wasted;
+
+  /// @brief The number of bytes given back to the system.
+  std::size_t returned;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Allocate each unified data separately with new[].
+///
+/// It doesn't know the size of deallocated blocks, thus it has no statistics.
+struct heap_allocator
+{
+  char*
+  allocate(std::size_t size)
+  {
+    return new char[size];
+  }
+
+  void
+  deallocate(const char* p)
+  noexcept
+  {
+    delete[] p;
+  }
+
+  /// @brief Nothing to release.
+  void
+  release()
+  noexcept
+  {}
+
+  allocator_statistics
+  stats()
+  const noexcept
+  {
+    return {0, 0, 0};
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A set of non-null keys, open-addressed with linear probing and at most half full.
+///
+/// Used by slab_allocator to tell its chunks apart from other memory.
+class key_set
+{
+  // Can't copy a key_set.
+  key_set(const key_set&) = delete;
+  key_set& operator=(const key_set&) = delete;
+
+public:
+
+  key_set()
+    : m_slots{nullptr}
+    , m_capacity{0}
+    , m_size{0}
+  {}
+
+  /// @brief Make sure a key can be inserted without allocating.
+  void
+  reserve_one()
+  {
+    if (2 * (m_size + 1) <= m_capacity)
+    {
+      return;
+    }
+    const auto capacity = m_capacity == 0 ? 16 : m_capacity * 2;
+    auto slots = std::make_unique<std::uintptr_t[]>(capacity);
+    for (auto i = 0ul; i < m_capacity; ++i)
+    {
+      if (m_slots[i] != 0)
+      {
+        slots[free_slot(slots.get(), capacity, m_slots[i])] = m_slots[i];
+      }
+    }
+    m_slots = std::move(slots);
+    m_capacity = capacity;
+  }
+
+  /// @brief Insert a key, after reserve_one().
+  void
+  insert(std::uintptr_t key)
+  noexcept
+  {
+    assert(key != 0 and 2 * (m_size + 1) <= m_capacity);
+    m_slots[free_slot(m_slots.get(), m_capacity, key)] = key;
+    ++m_size;
+  }
+
+  /// @brief Tell if a key is in the set.
+  bool
+  contains(std::uintptr_t key)
+  const noexcept
+  {
+    if (m_capacity == 0)
+    {
+      return false;
+    }
+    for (auto i = home(key, m_capacity); m_slots[i] != 0; i = (i + 1) & (m_capacity - 1))
+    {
+      if (m_slots[i] == key)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// @brief Remove a key of the set.
+  ///
+  /// The following keys of the same run are shifted back, so there is no tombstone.
+  void
+  erase(std::uintptr_t key)
+  noexcept
+  {
+    const auto mask = m_capacity - 1;
+    auto hole = home(key, m_capacity);
+    while (m_slots[hole] != key)
+    {
+      hole = (hole + 1) & mask;
+    }
+    for (auto i = (hole + 1) & mask; m_slots[i] != 0; i = (i + 1) & mask)
+    {
+      // The key in i can fill the hole if its home is not in (hole, i].
+      if (((i - home(m_slots[i], m_capacity)) & mask) >= ((i - hole) & mask))
+      {
+        m_slots[hole] = m_slots[i];
+        hole = i;
+      }
+    }
+    m_slots[hole] = 0;
+    --m_size;
+  }
+
+private:
+
+  static
+  std::size_t
+  home(std::uintptr_t key, std::size_t capacity)
+  noexcept
+  {
+    return static_cast<std::size_t>((key * std::uint64_t{0x9e3779b97f4a7c15}) >> 32)
+         & (capacity - 1);
+  }
+
+  static
+  std::size_t
+  free_slot(const std::uintptr_t* slots, std::size_t capacity, std::uintptr_t key)
+  noexcept
+  {
+    auto i = home(key, capacity);
+    while (slots[i] != 0)
+    {
+      i = (i + 1) & (capacity - 1);
+    }
+    return i;
+  }
+
+  std::unique_ptr<std::uintptr_t[]> m_slots;
+  std::size_t m_capacity;
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Allocate unified data in slabs of blocks of the same size class.
+///
+/// Sizes are rounded up to a multiple of 16 bytes, up to max_block_size; each size class takes its
+/// blocks from chunks of chunk_size bytes, which keep their own list of free blocks. Chunks are
+/// aligned on their size, thus the chunk of a block is found by masking its address, without any
+/// per-block header. A chunk is given back to the system as soon as all its blocks are free,
+/// unless it's the last one with free blocks of its size class, so a class doesn't allocate and
+/// release a chunk repeatedly.
+///
+/// Larger blocks are allocated with ::operator new, after a header which keeps their size. The
+/// allocator knows the addresses of its chunks, so it tells them apart without reading any memory
+/// around a block, as a large block can't be in the same chunk_size-aligned range as a chunk.
+///
+/// Blocks of a new chunk are carved on demand, so the pages of a chunk are touched only when
+/// needed. All blocks must have been deallocated when the allocator is destroyed.
+class slab_allocator
+{
+  // Can't copy a slab_allocator.
+  slab_allocator(const slab_allocator&) = delete;
+  slab_allocator& operator=(const slab_allocator&) = delete;
+
+public:
+
+  /// @brief The size and the alignment of chunks.
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  /// @brief The difference between two consecutive size classes.
+  static constexpr std::size_t granularity = 16;
+
+  /// @brief Larger blocks are allocated with ::operator new.
+  static constexpr std::size_t max_block_size = 512;
+
+private:
+
+  static_assert(granularity % alignof(std::max_align_t) == 0, "Misaligned blocks");
+
+  /// @brief The number of size classes.
+  static constexpr std::size_t nb_classes = max_block_size / granularity;
+
+  /// @brief The start of a chunk.
+  struct alignas(std::max_align_t) chunk
+  {
+    /// @brief The previous chunk with free blocks of the same size class.
+    chunk* prev;
+
+    /// @brief The next chunk with free blocks of the same size class.
+    chunk* next;
+
+    /// @brief The free blocks of this chunk, linked through their first bytes.
+    void* free_list;
+
+    /// @brief The part of this chunk which has never been allocated.
+    char* unused;
+
+    /// @brief The number of allocated blocks.
+    std::uint32_t nb_used;
+
+    /// @brief The size class.
+    std::uint32_t size_class;
+
+    /// @brief Tell if this chunk is linked in its size class' list.
+    bool linked;
+
+    /// @brief The links of the list of all chunks.
+    chunk* all_prev;
+    chunk* all_next;
+
+    /// @brief Where this chunk was allocated (see allocate_chunk).
+    void* origin;
+  };
+
+  /// @brief The number of bytes before the first block of a chunk.
+  static constexpr std::size_t header_size
+    = (sizeof(chunk) + granularity - 1) / granularity * granularity;
+
+  /// @brief The number of bytes before a large block, where its size is kept.
+  static constexpr std::size_t large_header_size = granularity;
+
+  static_assert(large_header_size >= sizeof(std::size_t), "Large block header is too small");
+
+public:
+
+  slab_allocator()
+    : m_classes{}
+    , m_all{nullptr}
+    , m_chunks{}
+    , m_stats{0, 0, 0}
+  {}
+
+  ~slab_allocator()
+  {
+    assert(m_stats.used == 0 && "Blocks still allocated");
+    while (m_all != nullptr)
+    {
+      release_chunk(m_all);
+    }
+  }
+
+  /// @brief Allocate a block of at least size bytes.
+  char*
+  allocate(std::size_t size)
+  {
+    if (size > max_block_size)
+    {
+      auto* header = static_cast<char*>(::operator new(large_header_size + size));
+      *reinterpret_cast<std::size_t*>(header) = size;
+      m_stats.used += size;
+      return header + large_header_size;
+    }
+    const auto cls = size == 0 ? 0 : (size - 1) / granularity;
+    auto* c = m_classes[cls];
+    if (c == nullptr)
+    {
+      c = allocate_chunk(static_cast<std::uint32_t>(cls));
+      m_stats.wasted += chunk_size - header_size;
+      link(c);
+    }
+    const auto block_size = (cls + 1) * granularity;
+    char* res;
+    if (c->free_list != nullptr)
+    {
+      res = static_cast<char*>(c->free_list);
+      c->free_list = *reinterpret_cast<void**>(res);
+    }
+    else
+    {
+      res = c->unused;
+      c->unused += block_size;
+    }
+    ++c->nb_used;
+    m_stats.used += block_size;
+    m_stats.wasted -= block_size;
+    if (c->free_list == nullptr and not has_room(c))
+    {
+      unlink(c);
+    }
+    return res;
+  }
+
+  /// @brief Give back a block obtained from allocate().
+  void
+  deallocate(const char* p)
+  noexcept
+  {
+    assert(p != nullptr);
+    if (not m_chunks.contains(reinterpret_cast<std::uintptr_t>(p) / chunk_size))
+    {
+      const auto* header = p - large_header_size;
+      const auto size = *reinterpret_cast<const std::size_t*>(header);
+      m_stats.used -= size;
+      m_stats.returned += large_header_size + size;
+      ::operator delete(const_cast<char*>(header));
+      return;
+    }
+    auto* c = chunk_of(p);
+    assert(c->nb_used != 0);
+    const auto block_size = (c->size_class + 1) * granularity;
+    auto* block = const_cast<char*>(p);
+    *reinterpret_cast<void**>(block) = c->free_list;
+    c->free_list = block;
+    --c->nb_used;
+    m_stats.used -= block_size;
+    m_stats.wasted += block_size;
+    if (not c->linked)
+    {
+      link(c);
+    }
+    else if (c->nb_used == 0 and (c->prev != nullptr or c->next != nullptr))
+    {
+      // Keep this chunk only if it's the last one of its class with free blocks.
+      unlink(c);
+      m_stats.wasted -= chunk_size - header_size;
+      release_chunk(c);
+    }
+  }
+
+  /// @brief Give back to the system all chunks without any allocated block.
+  void
+  release()
+  noexcept
+  {
+    for (auto& head : m_classes)
+    {
+      for (auto* c = head; c != nullptr;)
+      {
+        auto* next = c->next;
+        if (c->nb_used == 0)
+        {
+          unlink(c);
+          m_stats.wasted -= chunk_size - header_size;
+          release_chunk(c);
+        }
+        c = next;
+      }
+    }
+  }
+
+  /// @brief Get the statistics of this allocator.
+  ///
+  /// Wasted bytes are those of free blocks and of the never used part of chunks.
+  allocator_statistics
+  stats()
+  const noexcept
+  {
+    return m_stats;
+  }
+
+private:
+
+  static
+  chunk*
+  chunk_of(const char* p)
+  noexcept
+  {
+    return reinterpret_cast<chunk*>(reinterpret_cast<std::uintptr_t>(p) & ~(chunk_size - 1));
+  }
+
+  /// @brief Tell if the never used part of a chunk can hold one more block.
+  static
+  bool
+  has_room(const chunk* c)
+  noexcept
+  {
+    const auto end = reinterpret_cast<const char*>(c) + chunk_size;
+    return end - c->unused >= static_cast<std::ptrdiff_t>((c->size_class + 1) * granularity);
+  }
+
+  /// @brief Allocate a chunk aligned on its size.
+  chunk*
+  allocate_chunk(std::uint32_t size_class)
+  {
+    m_chunks.reserve_one();
+#ifdef COREDD_HAS_POSIX_MEMALIGN
+    void* origin = nullptr;
+    if (posix_memalign(&origin, chunk_size, chunk_size) != 0)
+    {
+      throw std::bad_alloc{};
+    }
+    auto* c = static_cast<chunk*>(origin);
+#else
+    void* origin = ::operator new(2 * chunk_size - 1);
+    auto* c = chunk_of(static_cast<char*>(origin) + chunk_size - 1);
+#endif
+    m_chunks.insert(reinterpret_cast<std::uintptr_t>(c) / chunk_size);
+    c->prev = nullptr;
+    c->next = nullptr;
+    c->free_list = nullptr;
+    c->unused = reinterpret_cast<char*>(c) + header_size;
+    c->nb_used = 0;
+    c->size_class = size_class;
+    c->linked = false;
+    c->all_prev = nullptr;
+    c->all_next = m_all;
+    c->origin = origin;
+    if (m_all != nullptr)
+    {
+      m_all->all_prev = c;
+    }
+    m_all = c;
+    return c;
+  }
+
+  /// @brief Give a chunk back to the system.
+  void
+  release_chunk(chunk* c)
+  noexcept
+  {
+    if (c->all_prev != nullptr)
+    {
+      c->all_prev->all_next = c->all_next;
+    }
+    else
+    {
+      m_all = c->all_next;
+    }
+    if (c->all_next != nullptr)
+    {
+      c->all_next->all_prev = c->all_prev;
+    }
+    m_chunks.erase(reinterpret_cast<std::uintptr_t>(c) / chunk_size);
+    m_stats.returned += chunk_size;
+#ifdef COREDD_HAS_POSIX_MEMALIGN
+    std::free(c->origin);
+#else
+    ::operator delete(c->origin);
+#endif
+  }
+
+  /// @brief Add a chunk to the chunks with free blocks of its size class.
+  void
+  link(chunk* c)
+  noexcept
+  {
+    auto& head = m_classes[c->size_class];
+    c->prev = nullptr;
+    c->next = head;
+    if (head != nullptr)
+    {
+      head->prev = c;
+    }
+    head = c;
+    c->linked = true;
+  }
+
+  /// @brief Remove a chunk from the chunks with free blocks of its size class.
+  void
+  unlink(chunk* c)
+  noexcept
+  {
+    if (c->prev != nullptr)
+    {
+      c->prev->next = c->next;
+    }
+    else
+    {
+      m_classes[c->size_class] = c->next;
+    }
+    if (c->next != nullptr)
+    {
+      c->next->prev = c->prev;
+    }
+    c->prev = nullptr;
+    c->next = nullptr;
+    c->linked = false;
+  }
+
+private:
+
+  /// @brief For each size class, the chunks with free blocks.
+  chunk* m_classes[nb_classes];
+
+  /// @brief All chunks, to release them on destruction.
+  chunk* m_all;
+
+  /// @brief The addresses of all chunks, divided by chunk_size.
+  key_set m_chunks;
+
+  /// @brief The statistics of this allocator.
+  allocator_statistics m_stats;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cassert>
 #include <memory> // unique_ptr
+#include <vector>
 
 namespace coredd { namespace detail
 {
@@ -8,6 +10,8 @@ namespace coredd { namespace detail
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief Fixed-size pool allocator for cache entries.
+///
+/// It can grow by chunks, the memory of which is only released with the pool.
 template <typename T>
 class pool
 {
@@ -23,13 +27,27 @@ public:
 
   pool(std::size_t size)
     : m_head(std::make_unique<node[]>(size))
-    , m_free_list(m_head.get())
+    , m_free_list(link(m_head.get(), size, nullptr))
+    , m_chunks()
+    , m_capacity(size)
+  {}
+
+  /// @brief Add size blocks to the pool.
+  void
+  grow(std::size_t size)
   {
-    for (auto i = 0ul; i < size - 1; ++i)
-    {
-      m_free_list[i].next = &m_free_list[i+1];
-    }
-    m_free_list[size - 1].next = nullptr;
+    assert(size > 0);
+    m_chunks.push_back(std::make_unique<node[]>(size));
+    m_free_list = link(m_chunks.back().get(), size, m_free_list);
+    m_capacity += size;
+  }
+
+  /// @brief Get the number of blocks of the pool.
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_capacity;
   }
 
   void*
@@ -54,8 +72,28 @@ public:
 
 private:
 
+  /// @brief Link the nodes of a chunk in front of a free list.
+  static
+  node*
+  link(node* chunk, std::size_t size, node* free_list)
+  noexcept
+  {
+    for (auto i = 0ul; i < size - 1; ++i)
+    {
+      chunk[i].next = &chunk[i+1];
+    }
+    chunk[size - 1].next = free_list;
+    return chunk;
+  }
+
   std::unique_ptr<node[]> m_head;
   node* m_free_list;
+
+  /// @brief The chunks added by grow().
+  std::vector<std::unique_ptr<node[]>> m_chunks;
+
+  /// @brief The number of blocks of all chunks.
+  std::size_t m_capacity;
 };
 
 /*------------------------------------------------------------------------------------------------*/
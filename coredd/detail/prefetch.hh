@@ -0,0 +1,31 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Hint that the memory at the given address will soon be read.
+///
+/// It does nothing when the compiler doesn't provide __builtin_prefetch. The address may be null.
+inline
+void
+prefetch(const void* addr)
+noexcept
+{
+#if defined __GNUC__ || defined __clang__
+  __builtin_prefetch(addr);
+#else
+  static_cast<void>(addr);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
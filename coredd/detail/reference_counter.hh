@@ -0,0 +1,590 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint> // int64_t, uint32_t, uint64_t
+#include <limits>  // numeric_limits
+#include <memory>  // unique_ptr
+#include <mutex>
+#include <utility> // swap
+#include <vector>
+
+namespace coredd {
+
+template <typename Unique>
+struct deletion_hook;
+
+} // namespace coredd
+
+namespace coredd { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A reference counter which can't be shared by several threads.
+class plain_reference_counter
+{
+public:
+
+  /// @brief Tell if references can be taken and dropped by several threads at once.
+  static constexpr bool thread_safe = false;
+
+  plain_reference_counter()
+  noexcept
+    : m_count{0}
+  {}
+
+  void
+  increment()
+  noexcept
+  {
+    if (m_count < immortal)
+    {
+      assert(m_count + 1 < immortal);
+      ++m_count;
+    }
+  }
+
+  /// @brief Increment the counter, unless there are no more references.
+  bool
+  try_increment()
+  noexcept
+  {
+    if (m_count == 0)
+    {
+      return false;
+    }
+    increment();
+    return true;
+  }
+
+  /// @return true if there are no more references.
+  template <typename Data>
+  bool
+  decrement(const Data*)
+  noexcept
+  {
+    if (m_count >= immortal)
+    {
+      return false;
+    }
+    assert(m_count > 0);
+    return --m_count == 0;
+  }
+
+  bool
+  is_zero()
+  const noexcept
+  {
+    return m_count == 0;
+  }
+
+  /// @brief Saturate the counter: references are no longer counted, and never all dropped.
+  void
+  make_immortal()
+  noexcept
+  {
+    m_count |= immortal;
+  }
+
+  bool
+  is_immortal()
+  const noexcept
+  {
+    return m_count >= immortal;
+  }
+
+  /// @brief Nothing is ever pending.
+  static
+  void
+  merge_pending()
+  noexcept
+  {}
+
+private:
+
+  /// @brief Set in the count of immortal data.
+  static constexpr std::uint32_t immortal = std::uint32_t{1} << 31;
+
+  std::uint32_t m_count;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An atomic reference counter.
+///
+/// Taking a reference only needs a relaxed increment, as it's always done from an existing
+/// reference. Dropping a reference is acquire-release, so the thread which drops the last one sees
+/// all the modifications done by other threads before they dropped their references. The counter
+/// of an immortal data is only read, so its cache line is shared rather than bounced between cores.
+class atomic_reference_counter
+{
+public:
+
+  /// @brief Tell if references can be taken and dropped by several threads at once.
+  static constexpr bool thread_safe = true;
+
+  atomic_reference_counter()
+  noexcept
+    : m_count{0}
+  {}
+
+  void
+  increment()
+  noexcept
+  {
+    if (m_count.load(std::memory_order_relaxed) < immortal)
+    {
+      m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Increment the counter, unless there are no more references.
+  bool
+  try_increment()
+  noexcept
+  {
+    auto count = m_count.load(std::memory_order_relaxed);
+    do
+    {
+      if (count == 0)
+      {
+        return false;
+      }
+      if (count >= immortal)
+      {
+        return true;
+      }
+    } while (not m_count.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+    return true;
+  }
+
+  /// @return true if there are no more references.
+  template <typename Data>
+  bool
+  decrement(const Data*)
+  noexcept
+  {
+    if (m_count.load(std::memory_order_relaxed) >= immortal)
+    {
+      return false;
+    }
+    // Still correct if the data has been made immortal since: the count can't be 1 anymore.
+    return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  bool
+  is_zero()
+  const noexcept
+  {
+    return m_count.load(std::memory_order_acquire) == 0;
+  }
+
+  /// @brief Saturate the counter: references are no longer counted, and never all dropped.
+  void
+  make_immortal()
+  noexcept
+  {
+    m_count.fetch_or(immortal, std::memory_order_relaxed);
+  }
+
+  bool
+  is_immortal()
+  const noexcept
+  {
+    return m_count.load(std::memory_order_relaxed) >= immortal;
+  }
+
+  /// @brief Nothing is ever pending.
+  static
+  void
+  merge_pending()
+  noexcept
+  {}
+
+private:
+
+  /// @brief Set in the count of immortal data.
+  static constexpr std::uint32_t immortal = std::uint32_t{1} << 31;
+
+  std::atomic<std::uint32_t> m_count;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A reference counter biased towards the thread which created the data.
+///
+/// The owner thread counts its references without atomic operations, other threads use an atomic
+/// shared counter. As references can be handed over between threads, the shared counter becomes
+/// negative when another thread drops a reference taken by the owner; the data may then be no
+/// longer referenced while the owner counter is still positive. The first thread to make it
+/// negative queues the data to its owner, which merges both counters the next time it unifies a
+/// data (see basic_unicity::make_sized()) or when it exits. The owner also merges its counter when
+/// it drops its last reference, if the data has not been queued. Once merged, all threads use the
+/// shared counter, and the thread which drops the last reference erases the data.
+///
+/// Data mostly used by the thread which created them are thus almost as cheap as with a plain
+/// counter, at the cost of a larger counter. Data handed over to other threads may be erased
+/// later than with an atomic counter. Immortal data are flagged in the shared word, which other
+/// threads then only read.
+class biased_reference_counter
+{
+  // Can't copy a biased_reference_counter.
+  biased_reference_counter(const biased_reference_counter&) = delete;
+  biased_reference_counter& operator=(const biased_reference_counter&) = delete;
+
+public:
+
+  /// @brief Tell if references can be taken and dropped by several threads at once.
+  static constexpr bool thread_safe = true;
+
+  biased_reference_counter()
+    : m_owner{owner::current()}
+    , m_biased{0}
+    , m_merged{false}
+    , m_shared{zero}
+  {}
+
+  void
+  increment()
+  noexcept
+  {
+    if (owned())
+    {
+      assert(m_biased < std::numeric_limits<std::uint32_t>::max());
+      ++m_biased;
+    }
+    else if ((m_shared.load(std::memory_order_relaxed) & immortal_flag) == 0)
+    {
+      m_shared.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Increment the counter, unless there are no more references.
+  bool
+  try_increment()
+  noexcept
+  {
+    if (owned() and m_biased != 0)
+    {
+      ++m_biased;
+      return true;
+    }
+    auto word = m_shared.load(std::memory_order_relaxed);
+    do
+    {
+      if ((word & immortal_flag) != 0)
+      {
+        return true;
+      }
+      if ((word & merged_flag) != 0 and count(word) == 0)
+      {
+        return false;
+      }
+    } while (not m_shared.compare_exchange_weak(word, word + 1, std::memory_order_relaxed));
+    return true;
+  }
+
+  /// @param x The data counted by this counter, queued to its owner if needed.
+  /// @return true if there are no more references.
+  template <typename Data>
+  bool
+  decrement(const Data* x)
+  noexcept
+  {
+    if (owned())
+    {
+      if (m_biased > 1)
+      {
+        --m_biased;
+        return false;
+      }
+      // Drop the last reference of the owner, or a reference taken by another thread.
+      const auto from_shared = m_biased == 0;
+      m_biased = 0;
+      // Once merged, another thread may erase the data: it must no longer be accessed.
+      m_merged = true;
+      auto word = m_shared.load(std::memory_order_relaxed);
+      while (true)
+      {
+        if ((word & immortal_flag) != 0)
+        {
+          m_merged = false;
+          return false;
+        }
+        if ((word & queued_flag) != 0)
+        {
+          // The pending merge will tell if there are references left.
+          m_merged = false;
+          if (from_shared)
+          {
+            m_shared.fetch_sub(1, std::memory_order_acq_rel);
+          }
+          return false;
+        }
+        const auto merged_word = (word | merged_flag) - (from_shared ? 1 : 0);
+        if (m_shared.compare_exchange_weak( word, merged_word, std::memory_order_acq_rel
+                                          , std::memory_order_relaxed))
+        {
+          return count(merged_word) == 0;
+        }
+      }
+    }
+    auto word = m_shared.load(std::memory_order_relaxed);
+    std::uint64_t new_word;
+    do
+    {
+      if ((word & immortal_flag) != 0)
+      {
+        return false;
+      }
+      new_word = word - 1;
+      if ((word & (merged_flag | queued_flag)) == 0 and count(new_word) < 0)
+      {
+        new_word |= queued_flag;
+      }
+    } while (not m_shared.compare_exchange_weak( word, new_word, std::memory_order_acq_rel
+                                               , std::memory_order_relaxed));
+    if ((new_word & merged_flag) != 0)
+    {
+      return count(new_word) == 0;
+    }
+    if ((new_word & queued_flag) != 0 and (word & queued_flag) == 0)
+    {
+      return m_owner->enqueue({x, this, &release<Data>});
+    }
+    return false;
+  }
+
+  /// @brief Tell if there are no references.
+  ///
+  /// Before counters are merged, it's only known by the owner thread.
+  bool
+  is_zero()
+  const noexcept
+  {
+    const auto word = m_shared.load(std::memory_order_acquire);
+    if ((word & immortal_flag) != 0)
+    {
+      return false;
+    }
+    if ((word & merged_flag) != 0)
+    {
+      return count(word) == 0;
+    }
+    return m_owner == owner::local() and m_biased + count(word) == 0;
+  }
+
+  /// @brief Saturate the counter: references are no longer counted, and never all dropped.
+  void
+  make_immortal()
+  noexcept
+  {
+    m_shared.fetch_or(immortal_flag, std::memory_order_relaxed);
+  }
+
+  bool
+  is_immortal()
+  const noexcept
+  {
+    return (m_shared.load(std::memory_order_relaxed) & immortal_flag) != 0;
+  }
+
+  /// @brief Merge the counters of the data queued to the current thread by other threads.
+  ///
+  /// Queued data which are no longer referenced are released.
+  static
+  void
+  merge_pending()
+  noexcept
+  {
+    if (owner::local() != nullptr)
+    {
+      owner::local()->merge_pending(false);
+    }
+  }
+
+private:
+
+  /// @brief A data queued to its owner.
+  struct pending
+  {
+    const void* data;
+    biased_reference_counter* counter;
+    void (*release)(const void*);
+  };
+
+  /// @brief A thread which owns data.
+  ///
+  /// Owners are never freed, so a data doesn't outlive its owner, and the owner of a data is never
+  /// mistaken with a thread created later.
+  class owner
+  {
+  public:
+
+    /// @brief The owner of the current thread, nullptr if it doesn't own any data yet.
+    static
+    owner*&
+    local()
+    noexcept
+    {
+      static thread_local owner* res = nullptr;
+      return res;
+    }
+
+    /// @brief The owner of the current thread, created if needed.
+    static
+    owner*
+    current()
+    {
+      auto& res = local();
+      if (res == nullptr)
+      {
+        static std::mutex mutex;
+        static std::vector<std::unique_ptr<owner>> owners;
+        {
+          std::lock_guard<std::mutex> lock{mutex};
+          owners.push_back(std::make_unique<owner>());
+          res = owners.back().get();
+        }
+        // Merge pending data when the thread exits.
+        static thread_local exit_guard guard;
+        (void)guard;
+      }
+      return res;
+    }
+
+    /// @brief Queue a data to this owner.
+    /// @return true if the owner has exited and the data is no longer referenced.
+    bool
+    enqueue(const pending& p)
+    noexcept
+    {
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (not m_exited)
+        {
+          m_queue.push_back(p);
+          return false;
+        }
+      }
+      // The owner is gone, its counter can be merged by this thread.
+      return p.counter->merge();
+    }
+
+    /// @brief Merge and release queued data.
+    void
+    merge_pending(bool exiting)
+    noexcept
+    {
+      std::vector<pending> queue;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        std::swap(queue, m_queue);
+        m_exited = exiting;
+      }
+      for (const auto& p : queue)
+      {
+        if (p.counter->merge())
+        {
+          p.release(p.data);
+        }
+      }
+    }
+
+    owner()
+      : m_mutex{}, m_queue{}, m_exited{false}
+    {}
+
+  private:
+
+    std::mutex m_mutex;
+    std::vector<pending> m_queue;
+    bool m_exited;
+  };
+
+  /// @brief Merge the data queued to a thread when it exits.
+  struct exit_guard
+  {
+    ~exit_guard()
+    {
+      owner::local()->merge_pending(true);
+    }
+  };
+
+  /// @brief Merge the owner counter into the shared one.
+  /// @return true if there are no more references.
+  ///
+  /// Called by the owner thread, or by another one once the owner has exited.
+  bool
+  merge()
+  noexcept
+  {
+    assert(not m_merged);
+    m_merged = true;
+    const auto delta = merged_flag + m_biased;
+    m_biased = 0;
+    const auto word = m_shared.fetch_add(delta, std::memory_order_acq_rel) + delta;
+    return (word & immortal_flag) == 0 and count(word) == 0;
+  }
+
+  /// @brief Release a queued data.
+  template <typename Data>
+  static
+  void
+  release(const void* x)
+  {
+    deletion_hook<Data>::release(static_cast<const Data*>(x));
+  }
+
+  /// @brief Tell if the current thread can use the owner counter.
+  bool
+  owned()
+  const noexcept
+  {
+    // m_merged is only accessed by the owner thread, until it exits.
+    return m_owner == owner::local() and not m_merged;
+  }
+
+  /// @brief The number of references of a shared word.
+  static
+  std::int64_t
+  count(std::uint64_t word)
+  noexcept
+  {
+    return static_cast<std::int64_t>(word & (queued_flag - 1)) - static_cast<std::int64_t>(zero);
+  }
+
+  /// @brief Set in the shared word of immortal data.
+  static constexpr std::uint64_t immortal_flag = std::uint64_t{1} << 63;
+
+  /// @brief Set in the shared word once the owner counter has been merged.
+  static constexpr std::uint64_t merged_flag = std::uint64_t{1} << 62;
+
+  /// @brief Set in the shared word once the data has been queued to its owner.
+  static constexpr std::uint64_t queued_flag = std::uint64_t{1} << 61;
+
+  /// @brief The shared word when there are no references, so the shared counter can be negative.
+  static constexpr std::uint64_t zero = std::uint64_t{1} << 60;
+
+  /// @brief The thread which created the data.
+  owner* const m_owner;
+
+  /// @brief The references counted by the owner thread.
+  std::uint32_t m_biased;
+
+  /// @brief Tell if the owner counter has been merged into the shared one.
+  bool m_merged;
+
+  /// @brief The references counted by other threads, and the immortal, merged and queued flags.
+  std::atomic<std::uint64_t> m_shared;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace coredd::detail
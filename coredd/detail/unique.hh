@@ -7,29 +7,119 @@
 #pragma once
 
 #include <cassert>
-#include <cstdint>     // uint32_t
 #include <functional>  // hash
-#include <limits>      // numeric_limits
 #include <type_traits> // is_nothrow_constructible
 #include <utility>     // forward
 
+#include "coredd/conf.hh"
 #include "coredd/detail/intrusive_member_hook.hh"
-#include "coredd//packed.hh"
+#include "coredd/packed.hh"
 
 namespace coredd { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief The owner of a unified data, when several unicities of the same type may exist.
+template <bool MultipleInstances>
+class unique_owner
+{
+public:
+
+  /// @brief Get the unique table of this data.
+  void*
+  owner()
+  const noexcept
+  {
+    return m_owner;
+  }
+
+  /// @brief Set the unique table of this data.
+  void
+  set_owner(void* owner)
+  noexcept
+  {
+    m_owner = owner;
+  }
+
+private:
+
+  void* m_owner = nullptr;
+};
+
+/// @brief The owner of a unified data is implicit when there is only one unicity of its type.
+template <>
+class unique_owner<false>
+{
+public:
+
+  void*
+  owner()
+  const noexcept
+  {
+    return nullptr;
+  }
+
+  void
+  set_owner(void*)
+  noexcept
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The links of a dead data, when dead data are kept for a while (see
+/// unicity_conf::dead_threshold).
+template <typename Unique>
+struct dead_links
+{
+  /// @brief The previous dead data of the unique table.
+  Unique* prev = nullptr;
+
+  /// @brief The next dead data of the unique table.
+  Unique* next = nullptr;
+};
+
+/// @brief The hook which links a dead data with the other dead data of its unique table.
+///
+/// A data is linked when it's no longer referenced, and unlinked when it's unified again, so
+/// collecting dead data doesn't walk the whole table.
+template <typename Unique, bool Deferred>
+class unique_dead_hook
+{
+public:
+
+  dead_links<Unique>&
+  dead_hook()
+  const noexcept
+  {
+    return m_dead_hook;
+  }
+
+private:
+
+  mutable dead_links<Unique> m_dead_hook;
+};
+
+/// @brief Dead data are reclaimed at once: no links are needed.
+template <typename Unique>
+class unique_dead_hook<Unique, false>
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief A wrapper to associate a reference counter to a unified data.
 ///
 /// This type is meant to be used by ptr, which takes care of incrementing and decrementing
 /// the reference counter, as well as the deletion of the held data.
-template <typename T>
+/// @tparam C The configuration of the unicity owning this data.
+template <typename T, typename C = unicity_conf>
 class
 #ifdef __clang__
 COREDD_ATTRIBUTE_PACKED
 #endif
 unique
+  : public unique_owner<C::multiple_instances>
+  , public unique_dead_hook<unique<T, C>, C::dead_threshold != 0>
 {
 public:
 
@@ -41,7 +131,7 @@ public:
   template <typename... Args>
   unique(Args&&... args)
   noexcept(std::is_nothrow_constructible<T, Args...>::value)
-    : m_hook(), m_ref_count(0), m_data(std::forward<Args>(args)...)
+    : m_hook(), m_ref_count(), m_data(std::forward<Args>(args)...)
   {}
 
   /// @brief Get a reference of the unified data.
@@ -57,7 +147,7 @@ public:
   is_not_referenced()
   const noexcept
   {
-    return m_ref_count == 0;
+    return m_ref_count.is_zero();
   }
 
   /// @brief Equality.
@@ -74,35 +164,70 @@ public:
   increment_reference_counter()
   noexcept
   {
-    assert(m_ref_count < std::numeric_limits<uint32_t>::max());
-    ++m_ref_count;
+    m_ref_count.increment();
+  }
+
+  /// @brief A ptr references that unified data, unless it's no longer referenced at all.
+  /// @return false if the data was no longer referenced, and thus is about to be erased.
+  ///
+  /// Used by concurrent unique tables: a data found in a table can't be referenced again once its
+  /// last reference has been dropped, as the thread which dropped it will erase it.
+  bool
+  try_increment_reference_counter()
+  noexcept
+  {
+    static_assert(C::concurrent, "Only for concurrent unique tables");
+    return m_ref_count.try_increment();
   }
 
   /// @brief A ptr no longer references that unified data.
-  void
+  /// @return true if the data is no longer referenced at all.
+  bool
   decrement_reference_counter()
   noexcept
   {
-    assert(m_ref_count > 0);
-    --m_ref_count;
+    return m_ref_count.decrement(this);
+  }
+
+  /// @brief The unified data will never be erased: references to it are no longer counted.
+  void
+  make_immortal()
+  noexcept
+  {
+    m_ref_count.make_immortal();
+  }
+
+  /// @brief Tell if the unified data will never be erased.
+  bool
+  is_immortal()
+  const noexcept
+  {
+    return m_ref_count.is_immortal();
   }
 
-  intrusive_member_hook<unique>&
+  member_hook<unique, C::store_hash>&
   hook()
   noexcept
   {
     return m_hook;
   }
 
+  const member_hook<unique, C::store_hash>&
+  hook()
+  const noexcept
+  {
+    return m_hook;
+  }
+
 private:
 
   /// @brief Used by mem::hash_table to store some informations.
-  intrusive_member_hook<unique> m_hook;
+  member_hook<unique, C::store_hash> m_hook;
 
   /// @brief The number of time the encapsulated data is referenced
   ///
-  /// Implements a reference-counting garbage collection.
-  std::uint32_t m_ref_count;
+  /// Implements a reference-counting garbage collection. See unicity_conf::reference_counter.
+  typename C::reference_counter m_ref_count;
 
   /// @brief The garbage collected data.
   /// @note This field must be the last one of this class to enable variable-length data
@@ -122,11 +247,11 @@ namespace std {
 
 /// @internal
 /// @brief Hash specialization for coredd:unique
-template <typename T>
-struct hash<coredd::detail::unique<T>>
+template <typename T, typename C>
+struct hash<coredd::detail::unique<T, C>>
 {
   std::size_t
-  operator()(const coredd::detail::unique<T>& x)
+  operator()(const coredd::detail::unique<T, C>& x)
   const noexcept(noexcept(hash<T>()(x.data())))
   {
     return hash<T>()(x.data());
@@ -7,9 +7,13 @@
 #pragma once
 
 #include <cassert>
-#include <memory> // unique_ptr
+#include <tuple>       // ignore, tie
+#include <type_traits> // false_type, integral_constant, true_type
+#include <vector>
 
-#include "coredd/detail/hash_table.hh"
+#include "coredd/conf.hh"
+#include "coredd/detail/node_allocator.hh"
+#include "coredd/lookup.hh"
 
 namespace coredd { namespace detail {
 
@@ -39,6 +43,9 @@ struct unique_table_statistics
   /// @brief The number of times the underlying hash table has been rehashed.
   std::size_t rehash;
 
+  /// @brief The number of times the underlying hash table has been shrunk.
+  std::size_t shrink;
+
   /// @brief The number of buckets with more than one element in the underlying hash table.
   std::size_t collisions;
 
@@ -50,14 +57,53 @@ struct unique_table_statistics
 
   /// @brief The number of buckets in the underlying hash table.
   std::size_t buckets;
+
+  /// @brief The length of the longest chain met by an insertion in the underlying hash table.
+  ///
+  /// It's a lower bound with COREDD_TAGGED_POINTERS, see longest_chain for exact lengths.
+  std::size_t max_chain;
+
+  /// @brief The length of the longest chain among sampled buckets, 0 if buckets were not sampled.
+  ///
+  /// Unlike max_chain, it's the current length of chains. See stats(std::size_t).
+  std::size_t longest_chain;
+
+  /// @brief The number of no longer referenced data still in the table.
+  std::size_t dead;
+
+  /// @brief The number of dead data which trigger their reclamation.
+  std::size_t dead_threshold;
+
+  /// @brief The number of dead data which have been unified again.
+  std::size_t resurrections;
+
+  /// @brief The ratio of resurrections to released data.
+  double resurrection_rate;
+
+  /// @brief The number of times dead data have been reclaimed.
+  std::size_t collections;
+
+  /// @brief The memory used, wasted and returned by the allocator of unified data.
+  ///
+  /// Only known by allocators which manage their own memory, like slab_allocator.
+  allocator_statistics memory;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
 /// @brief A table to unify data.
-template <typename Unique>
+/// @tparam C The configuration of the unicity owning this table.
+///
+/// If C::dead_threshold is not 0, Unique must provide dead_hook() (see unique_dead_hook).
+template <typename Unique, typename C = unicity_conf>
 class unique_table
 {
+  static_assert( C::min_load_factor < C::max_load_factor / 2
+               , "The unique table would grow again just after having shrunk");
+
+  /// @brief Tell if dead data are kept for a while.
+  using deferred = std::integral_constant<bool, C::dead_threshold != 0>;
+
 public:
 
   // Can't copy a unique_table.
@@ -67,12 +113,33 @@ public:
   /// @brief Constructor.
   /// @param initial_size Initial capacity of the container.
   unique_table(std::size_t initial_size)
-    : m_set{initial_size}
+    : m_alloc{}
+    , m_set{initial_size, C::max_load_factor, C::min_load_factor}
     , m_stats{}
     , m_cache{nullptr}
     , m_cache_size{0}
+    , m_nb_dead{0}
+    , m_nb_released{0}
+    , m_collecting{false}
+    , m_unifying{false}
+    , m_dead{nullptr}
+    , m_pending{nullptr}
+    , m_reclaiming{false}
   {}
 
+  /// @brief Destructor.
+  ///
+  /// Immortal data are destroyed too, thus no ptr to a data of this table must outlive it.
+  ~unique_table()
+  {
+    release_immortals();
+    collect();
+    if (m_cache != nullptr)
+    {
+      m_alloc.deallocate(m_cache);
+    }
+  }
+
   /// @brief Unify a data.
   /// @param ptr A pointer to a data constructed with a placement new into the storage returned by
   /// allocate().
@@ -89,17 +156,25 @@ public:
     if (not insertion.second) // ptr already exists
     {
       ++m_stats.hits;
+      revive(*insertion.first);
+      // The found data is not referenced yet, it must not be reclaimed by the destruction of ptr.
+      m_unifying = true;
       ptr->~Unique();
+      m_unifying = false;
       if ((sizeof(Unique) + extra_bytes) > m_cache_size)
       {
         // The inserted ptr's memory to cache is bigger than the previously held cache. Thus it
         // might fit better allocations request by allocate().
-        m_cache.reset(reinterpret_cast<char*>(ptr));
+        if (m_cache != nullptr)
+        {
+          m_alloc.deallocate(m_cache);
+        }
+        m_cache = reinterpret_cast<char*>(ptr);
         m_cache_size = sizeof(Unique) + extra_bytes;
       }
       else
       {
-        delete[] reinterpret_cast<char*>(ptr);  // match new char[] of allocate().
+        m_alloc.deallocate(reinterpret_cast<char*>(ptr));
       }
     }
     else
@@ -110,37 +185,90 @@ public:
     return *insertion.first;
   }
 
+  /// @brief Look for an already unified data.
+  /// @param hash The hash value of the data, as computed by std::hash<Unique>.
+  /// @param eq Tell if a unified data is the one looked for.
+  /// @return The unified data, or nullptr if there is none.
+  ///
+  /// Only hits are recorded, as a miss is followed by the unification of the data.
+  template <typename EqT>
+  Unique*
+  find(std::size_t hash, EqT eq)
+  {
+    auto* res = m_set.find(hashed_key{hash}, [&](const hashed_key&, const Unique& u){return eq(u);});
+    if (res != nullptr)
+    {
+      ++m_stats.access;
+      ++m_stats.hits;
+      revive(*res);
+    }
+    return res;
+  }
+
   /// @brief Allocate a memory block large enough for the given size.
   char*
   allocate(std::size_t extra_bytes)
   {
-    if (m_cache and m_cache_size >= (sizeof(Unique) + extra_bytes))
+    if (m_cache != nullptr and m_cache_size >= (sizeof(Unique) + extra_bytes))
     {
       // re-use cached allocation
-      auto res = m_cache.get();
-      m_cache.release();
+      auto res = m_cache;
+      m_cache = nullptr;
       m_cache_size = 0;
       return res;
     }
     else
     {
       // no cached allocation or it was too small
-      return new char[sizeof(Unique) + extra_bytes];
+      return m_alloc.allocate(sizeof(Unique) + extra_bytes);
     }
   }
 
   /// @brief Erase the given unified data.
   ///
-  /// All subsequent uses of the erased data are invalid.
+  /// If C::dead_threshold is not 0, x is kept until the number of dead data reaches this threshold,
+  /// and revived if it's unified again meanwhile. All subsequent uses of the erased data are
+  /// otherwise invalid.
   void
   erase(const Unique* x)
   noexcept
   {
     assert(x != nullptr);
     assert(x->is_not_referenced() && "Unique still referenced");
-    m_set.erase(x);
-    x->~Unique();
-    delete[] reinterpret_cast<const char*>(x); // match new char[] of allocate().
+    ++m_nb_released;
+    if (C::dead_threshold == 0 or m_collecting)
+    {
+      // Data released by the destruction of collected data are reclaimed at once.
+      m_set.erase(x);
+      reclaim(x);
+    }
+    else
+    {
+      link_dead(x, deferred{});
+      if (++m_nb_dead >= C::dead_threshold and not m_unifying)
+      {
+        collect();
+      }
+    }
+  }
+
+  /// @brief Release unused memory.
+  /// @return true if the underlying hash table has been shrunk.
+  ///
+  /// Dead data are reclaimed first.
+  bool
+  compact()
+  noexcept
+  {
+    collect();
+    if (m_cache != nullptr)
+    {
+      m_alloc.deallocate(m_cache);
+      m_cache = nullptr;
+      m_cache_size = 0;
+    }
+    m_alloc.release();
+    return m_set.compact();
   }
 
   /// @brief Get the statistics of this unique_table.
@@ -151,24 +279,236 @@ public:
     m_stats.size = m_set.size();
     m_stats.load_factor = m_set.load_factor();
     m_stats.rehash = m_set.nb_rehash();
+    m_stats.shrink = m_set.nb_shrink();
     std::tie(m_stats.collisions, m_stats.alone, m_stats.empty) = m_set.collisions();
     m_stats.buckets = m_set.bucket_count();
+    m_stats.max_chain = m_set.max_chain();
+    m_stats.longest_chain = 0;
+    m_stats.dead = m_nb_dead;
+    m_stats.dead_threshold = C::dead_threshold;
+    m_stats.resurrection_rate = m_nb_released == 0
+                              ? 0
+                              : static_cast<double>(m_stats.resurrections)
+                              / static_cast<double>(m_nb_released);
+    m_stats.memory = m_alloc.stats();
+    return m_stats;
+  }
+
+  /// @brief Get the statistics of this unique_table, with the longest chain of a sample of
+  /// buckets.
+  /// @param nb_samples The number of buckets to inspect.
+  ///
+  /// Its cost is proportional to nb_samples, and to the length of their chains. No bucket is
+  /// sampled if nb_samples is 0.
+  const unique_table_statistics&
+  stats(std::size_t nb_samples)
+  const noexcept
+  {
+    stats();
+    if (nb_samples != 0)
+    {
+      std::tie(std::ignore, std::ignore, std::ignore, m_stats.longest_chain)
+        = m_set.sample_collisions(nb_samples);
+    }
     return m_stats;
   }
 
 private:
 
+  /// @brief Account for the unification of a data which may be dead.
+  void
+  revive(const Unique& x)
+  noexcept
+  {
+    if (C::dead_threshold != 0 and x.is_not_referenced())
+    {
+      assert(m_nb_dead > 0);
+      --m_nb_dead;
+      ++m_stats.resurrections;
+      unlink_dead(x, deferred{});
+    }
+  }
+
+  /// @brief Add a data to the list of dead data.
+  void
+  link_dead(const Unique* x, std::true_type)
+  noexcept
+  {
+    auto& links = x->dead_hook();
+    links.prev = nullptr;
+    links.next = m_dead;
+    if (m_dead != nullptr)
+    {
+      m_dead->dead_hook().prev = const_cast<Unique*>(x);
+    }
+    m_dead = const_cast<Unique*>(x);
+  }
+
+  /// @brief Dead data are not kept.
+  void
+  link_dead(const Unique*, std::false_type)
+  noexcept
+  {}
+
+  /// @brief Remove a revived data from the list of dead data.
+  void
+  unlink_dead(const Unique& x, std::true_type)
+  noexcept
+  {
+    auto& links = x.dead_hook();
+    if (links.prev != nullptr)
+    {
+      links.prev->dead_hook().next = links.next;
+    }
+    else
+    {
+      m_dead = links.next;
+    }
+    if (links.next != nullptr)
+    {
+      links.next->dead_hook().prev = links.prev;
+    }
+  }
+
+  /// @brief Dead data are not kept.
+  void
+  unlink_dead(const Unique&, std::false_type)
+  noexcept
+  {}
+
+  /// @brief Reclaim all dead data, as a batch.
+  ///
+  /// Only the list of dead data is walked. Dead data are first removed from the table, then
+  /// destroyed. The data released by these destructions are reclaimed at once, as they were
+  /// referenced and thus not in the list.
+  void
+  collect()
+  noexcept
+  {
+    if (m_nb_dead != 0)
+    {
+      collect(deferred{});
+    }
+  }
+
+  /// @brief Reclaim the list of dead data.
+  void
+  collect(std::true_type)
+  noexcept
+  {
+    ++m_stats.collections;
+    for (auto* x = m_dead; x != nullptr; x = x->dead_hook().next)
+    {
+      assert(x->is_not_referenced());
+      m_set.erase(x);
+    }
+    auto* x = m_dead;
+    m_dead = nullptr;
+    m_nb_dead = 0;
+    m_collecting = true;
+    while (x != nullptr)
+    {
+      auto* next = x->dead_hook().next;
+      reclaim(x);
+      x = next;
+    }
+    m_collecting = false;
+  }
+
+  /// @brief Dead data are not kept.
+  void
+  collect(std::false_type)
+  noexcept
+  {}
+
+  /// @brief Destroy all immortal data.
+  ///
+  /// They are first gathered, as their destructions may erase the data they reference.
+  void
+  release_immortals()
+  {
+    std::vector<const Unique*> immortals;
+    m_set.for_each([&](const Unique& x)
+    {
+      if (x.is_immortal())
+      {
+        immortals.push_back(&x);
+      }
+    });
+    for (const auto* x : immortals)
+    {
+      m_set.erase(x);
+      reclaim(x);
+    }
+  }
+
+  /// @brief Destroy a data which is no longer in the table, as well as the data it releases.
+  ///
+  /// The destruction of a data may release other data, which are then erased too. Rather than
+  /// destroying them recursively, which could exhaust the stack with long chains of data, they are
+  /// queued and destroyed by the outermost call, linked through their hooks as they are no longer
+  /// in the table.
+  void
+  reclaim(const Unique* x)
+  noexcept
+  {
+    auto* u = const_cast<Unique*>(x);
+    u->hook().next = m_pending;
+    m_pending = u;
+    if (m_reclaiming)
+    {
+      return;
+    }
+    m_reclaiming = true;
+    while (m_pending != nullptr)
+    {
+      auto* y = m_pending;
+      m_pending = y->hook().next;
+      y->~Unique();
+      m_alloc.deallocate(reinterpret_cast<const char*>(y));
+    }
+    m_reclaiming = false;
+  }
+
+private:
+
+  /// @brief The allocator of unified data.
+  ///
+  /// Declared first, so it's destroyed last.
+  typename C::allocator_type m_alloc;
+
   /// @brief The actual container of unified data.
-  hash_table<Unique> m_set;
+  typename C::template hash_table_type<Unique, typename C::hash_policy> m_set;
 
   /// @brief The statistics of this unique_table.
   mutable unique_table_statistics m_stats;
 
   /// @brief Keep the memory of an insertion that was a hit.
-  std::unique_ptr<char[]> m_cache;
+  char* m_cache;
 
   /// @brief The number of bytes of the cached memory.
   std::size_t m_cache_size;
+
+  /// @brief The number of no longer referenced data still in the table.
+  std::size_t m_nb_dead;
+
+  /// @brief The number of times a data has been released.
+  std::size_t m_nb_released;
+
+  /// @brief Tell if dead data are being destroyed.
+  bool m_collecting;
+
+  /// @brief Tell if a duplicate of a unified data is being destroyed.
+  bool m_unifying;
+
+  /// @brief The first of the dead data, linked through their dead hooks.
+  Unique* m_dead;
+
+  /// @brief The erased data waiting to be destroyed, see reclaim().
+  Unique* m_pending;
+
+  /// @brief Tell if erased data are being destroyed.
+  bool m_reclaiming;
 };
 
 /*------------------------------------------------------------------------------------------------*/
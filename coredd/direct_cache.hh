@@ -0,0 +1,305 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <algorithm>   // max
+#include <cstdint>     // uint8_t
+#include <functional>  // hash
+#include <memory>      // unique_ptr
+#include <new>         // placement new
+#include <type_traits> // aligned_storage, result_of
+
+#include "coredd/cache.hh" // cache_statistics
+#include "coredd/conf.hh"
+#include "coredd/detail/apply_filters.hh"
+#include "coredd/detail/next_power.hh"
+
+namespace coredd {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A lossy cache: a fixed array of entries indexed by the hash values of operations.
+/// @tparam C is the configuration, see direct_cache_conf.
+/// @tparam Operation is the operation type.
+/// @tparam Filters is a list of filters that reject some operations.
+///
+/// It's the computed table of classic decision diagram packages. An operation can only be stored
+/// in the C::ways entries of the set given by its hash value; a new operation simply overwrites
+/// one of them. There are no chains to walk, no eviction order to maintain and no allocations, so
+/// it suits short-lived, very frequent operations, whose recomputation after an overwrite is
+/// cheaper than the bookkeeping of basic_cache. It has the same interface as basic_cache.
+template <typename C, typename Context, typename Operation, typename... Filters>
+class basic_direct_cache
+{
+  static_assert(C::ways == 1 or C::ways == 2, "Only direct-mapped and 2-way caches are supported");
+
+  // Can't copy a cache.
+  basic_direct_cache(const basic_direct_cache&) = delete;
+  basic_direct_cache& operator=(const basic_direct_cache&) = delete;
+
+private:
+
+  /// @brief The type of the context of this cache.
+  using context_type = Context;
+
+  /// @brief The type of the result of an operation stored in the cache.
+  using result_type = std::result_of_t<Operation(context_type&)>;
+
+  /// @brief An operation and its result.
+  struct entry
+  {
+    const Operation operation;
+    const result_type result;
+  };
+
+  /// @brief The place of an entry.
+  struct slot
+  {
+    /// @brief The mixed hash value of the operation, compared before the operation itself.
+    std::size_t hash = 0;
+
+    /// @brief Tell if an entry is stored.
+    bool full = false;
+
+    /// @brief With 2 ways, the most recently used way of the set, kept by its first slot.
+    std::uint8_t mru = 0;
+
+    std::aligned_storage_t<sizeof(entry), alignof(entry)> storage;
+
+    entry&
+    get()
+    noexcept
+    {
+      return *reinterpret_cast<entry*>(&storage);
+    }
+  };
+
+public:
+
+  /// @brief Construct a cache.
+  /// @param context This cache's context.
+  /// @param size How many cache entries are kept, rounded up to a power of 2.
+  ///
+  /// All the memory is allocated at construction.
+  basic_direct_cache(context_type& context, std::size_t size)
+    : m_cxt(context)
+    , m_nb_sets(detail::next_power_of_2(std::max(size / C::ways, std::size_t{1})))
+    , m_slots(std::make_unique<slot[]>(m_nb_sets * C::ways))
+    , m_size(0)
+    , m_stats()
+  {}
+
+  /// @brief Destructor.
+  ~basic_direct_cache()
+  {
+    clear();
+  }
+
+  /// @brief Cache lookup.
+  result_type
+  operator()(Operation&& op)
+  {
+    // Check if the current operation should be cached or not.
+    if (not detail::apply_filters<Operation, Filters...>()(op))
+    {
+      ++m_stats.filtered;
+      return op(m_cxt);
+    }
+
+    const auto hash = mix(op);
+    if (auto* s = find_slot(op, hash))
+    {
+      ++m_stats.hits;
+      return s->get().result;
+    }
+
+    ++m_stats.misses;
+    auto res = op(m_cxt); // evaluation may throw
+
+    // The evaluation may have modified the set of op, thus the victim is chosen only now.
+    auto& s = victim(hash);
+    if (s.full)
+    {
+      s.get().~entry();
+      s.full = false;
+      --m_size;
+      ++m_stats.discarded;
+    }
+    new (&s.storage) entry{std::move(op), std::move(res)};
+    s.hash = hash;
+    s.full = true;
+    ++m_size;
+    touch(set_of(hash), &s);
+    return s.get().result;
+  }
+
+  /// @brief Look for an operation from a key, without evaluating it if it's missing.
+  /// @return The cached result, or nullptr if the operation is not in the cache.
+  ///
+  /// See basic_cache::find().
+  template <typename Key>
+  const result_type*
+  find(const Key& key)
+  {
+    if (auto* s = find_slot(key, mix(key)))
+    {
+      ++m_stats.hits;
+      return &s->get().result;
+    }
+    return nullptr;
+  }
+
+  /// @brief Remove all entries of the cache.
+  void
+  clear()
+  noexcept
+  {
+    for (auto i = 0ul; i < m_nb_sets * C::ways; ++i)
+    {
+      if (m_slots[i].full)
+      {
+        m_slots[i].get().~entry();
+        m_slots[i].full = false;
+      }
+    }
+    m_size = 0;
+  }
+
+  /// @brief Get the number of cached operations.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Get the statistics of this cache.
+  ///
+  /// There are no chains: discarded counts overwritten entries and buckets counts entries.
+  const cache_statistics&
+  statistics()
+  const noexcept
+  {
+    const auto nb_slots = m_nb_sets * C::ways;
+    m_stats.size = m_size;
+    const auto nb_lookups = m_stats.hits + m_stats.misses;
+    m_stats.hit_ratio = nb_lookups == 0 ? 0 : static_cast<double>(m_stats.hits) / nb_lookups;
+    m_stats.collisions = 0;
+    m_stats.alone = m_size;
+    m_stats.empty = nb_slots - m_size;
+    m_stats.buckets = nb_slots;
+    m_stats.max_chain = C::ways;
+    m_stats.load_factor = static_cast<double>(m_size) / nb_slots;
+    return m_stats;
+  }
+
+  /// @brief Get the statistics of this cache.
+  ///
+  /// There are no chains to sample: longest_chain is the number of ways.
+  const cache_statistics&
+  statistics(std::size_t)
+  const noexcept
+  {
+    statistics();
+    m_stats.longest_chain = C::ways;
+    return m_stats;
+  }
+
+private:
+
+  template <typename Key>
+  static
+  std::size_t
+  mix(const Key& key)
+  noexcept(noexcept(std::hash<Key>()(key)))
+  {
+    return typename C::hash_policy{}(std::hash<Key>()(key));
+  }
+
+  /// @brief Get the first slot of the set of a hash value.
+  slot*
+  set_of(std::size_t hash)
+  const noexcept
+  {
+    return &m_slots[(hash & (m_nb_sets - 1)) * C::ways];
+  }
+
+  /// @brief Get the slot storing an operation equal to key, nullptr if there is none.
+  template <typename Key>
+  slot*
+  find_slot(const Key& key, std::size_t hash)
+  {
+    auto* set = set_of(hash);
+    auto* s = set;
+    if (C::ways == 2)
+    {
+      // Choose the way without a branch, which would be mispredicted half of the time. Both
+      // ways may only hold data with the same hash value if their operations are different.
+      s += not (s[0].full & (s[0].hash == hash));
+    }
+    if (s->full and s->hash == hash and key == s->get().operation)
+    {
+      touch(set, s);
+      return s;
+    }
+    return nullptr;
+  }
+
+  /// @brief Get the slot of a new operation: an empty one, or the least recently used of its set.
+  slot&
+  victim(std::size_t hash)
+  noexcept
+  {
+    auto* set = set_of(hash);
+    for (auto w = 0ul; w < C::ways; ++w)
+    {
+      if (not set[w].full)
+      {
+        return set[w];
+      }
+    }
+    return C::ways == 1 ? set[0] : set[1 - set[0].mru];
+  }
+
+  /// @brief Mark a slot as the most recently used of its set.
+  void
+  touch(slot* set, const slot* s)
+  noexcept
+  {
+    if (C::ways == 2)
+    {
+      // Unconditionally written: the set has just been read, and a test would often be
+      // mispredicted.
+      set->mru = static_cast<std::uint8_t>(s - set);
+    }
+  }
+
+  /// @brief This cache's context.
+  context_type& m_cxt;
+
+  /// @brief The number of sets, a power of 2.
+  const std::size_t m_nb_sets;
+
+  /// @brief The entries, C::ways consecutive slots per set.
+  std::unique_ptr<slot[]> m_slots;
+
+  /// @brief The number of stored entries.
+  std::size_t m_size;
+
+  /// @brief The statistics of this cache
+  mutable cache_statistics m_stats;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A direct-mapped cache, using the default configuration.
+template <typename Context, typename Operation, typename... Filters>
+using direct_cache = basic_direct_cache<direct_cache_conf, Context, Operation, Filters...>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace coredd
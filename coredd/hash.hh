@@ -7,6 +7,7 @@
 #pragma once
 
 #include <algorithm> // for_each
+#include <cstdint>   // uint64_t, uintptr_t
 #include <iterator>  // iterator_traits
 #include <utility>   // declval
 
@@ -108,4 +109,101 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Hash an address.
+///
+/// Unlike std::hash for pointers, which gives the address itself, all bits of the result depend
+/// on all bits of the address. Thus, the low bits, always 0 for aligned data, don't make hash
+/// tables using a power of 2 number of buckets put all addresses in a few buckets.
+inline
+std::size_t
+hash_pointer(const void* p)
+noexcept
+{
+  // The final avalanche of MurmurHash3 (fmix64).
+  std::uint64_t x = reinterpret_cast<std::uintptr_t>(p);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return static_cast<std::size_t>(x);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A hash policy which keeps hash values as they are.
+///
+/// A hash policy is applied by hash tables to the value given by std::hash, before it's masked
+/// to get a bucket. It must be noexcept and give the same result for the same value.
+struct identity_mixer
+{
+  std::size_t
+  operator()(std::size_t h)
+  const noexcept
+  {
+    return h;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A hash policy using the final avalanche step of XXH3.
+///
+/// It's cheap (two shifts and a multiplication) and makes all bits of the result depend on all
+/// bits of the hash value.
+struct xxh3_mixer
+{
+  std::size_t
+  operator()(std::size_t h)
+  const noexcept
+  {
+    std::uint64_t x = h;
+    x ^= x >> 37;
+    x *= 0x165667919e3779f9ull;
+    x ^= x >> 32;
+    return static_cast<std::size_t>(x);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A hash policy using the multiply-and-fold mixing of wyhash.
+///
+/// The full 128 bits product of the hash value with a constant is folded to 64 bits, then mixed
+/// once more as a final avalanche. It's stronger than xxh3_mixer, at the cost of two wide
+/// multiplications.
+struct wyhash_mixer
+{
+  std::size_t
+  operator()(std::size_t h)
+  const noexcept
+  {
+    const std::uint64_t x = mum(std::uint64_t{h} ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+    return static_cast<std::size_t>(mum(x ^ 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull));
+  }
+
+private:
+
+  /// @brief Multiply and fold the 128 bits product.
+  static
+  std::uint64_t
+  mum(std::uint64_t a, std::uint64_t b)
+  noexcept
+  {
+#if defined __SIZEOF_INT128__
+    const auto r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+    const std::uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffff, lb = b & 0xffffffff;
+    const std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const std::uint64_t t = rl + (rm0 << 32);
+    const std::uint64_t lo = t + (rm1 << 32);
+    const std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace coredd
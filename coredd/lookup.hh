@@ -0,0 +1,110 @@
+/// @file
+/// @copyright The code is licensed under the BSD License
+///            <http://opensource.org/licenses/BSD-2-Clause>,
+///            Copyright (c) 2012-2015 Alexandre Hamez.
+/// @author Alexandre Hamez
+
+#pragma once
+
+#include <functional>  // hash
+#include <type_traits> // true_type, false_type
+#include <utility>     // declval
+
+namespace coredd {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Look data of type T up from the arguments of their constructor.
+///
+/// basic_unicity::make() uses it to find an already unified data without allocating and
+/// constructing a new one, which is then done only when the data doesn't exist yet. To enable it
+/// for some constructor arguments args of T, specialize this structure with two static functions:
+///   - hash(args...), the same hash value as std::hash<T> for the data constructed from args;
+///   - equal(x, args...), true if x is equal to the data constructed from args.
+/// Data constructed from arguments without a matching hash() are constructed before being looked
+/// up. By default, only the copy or the move of an existing T is looked up.
+template <typename T>
+struct lookup
+{
+  static
+  std::size_t
+  hash(const T& x)
+  noexcept(noexcept(std::hash<T>()(x)))
+  {
+    return std::hash<T>()(x);
+  }
+
+  static
+  bool
+  equal(const T& lhs, const T& rhs)
+  noexcept(noexcept(lhs == rhs))
+  {
+    return lhs == rhs;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+/// @internal
+/// @brief Tell if lookup<T> can hash and compare constructor arguments Args.
+template <typename T, typename Void, typename... Args>
+struct has_lookup_impl
+  : std::false_type
+{};
+
+template <typename... Ts>
+struct make_void
+{
+  using type = void;
+};
+
+template <typename T, typename... Args>
+struct has_lookup_impl< T
+                      , typename make_void<
+                          decltype(lookup<T>::hash(std::declval<const Args&>()...))
+                        , decltype(lookup<T>::equal( std::declval<const T&>()
+                                                   , std::declval<const Args&>()...))>::type
+                      , Args...>
+  : std::true_type
+{};
+
+/// @internal
+template <typename T, typename... Args>
+using has_lookup = has_lookup_impl<T, void, std::decay_t<Args>...>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A key given to hash tables, which already knows its hash value.
+struct hashed_key
+{
+  std::size_t hash;
+};
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace coredd
+
+namespace std {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+template <>
+struct hash<coredd::detail::hashed_key>
+{
+  std::size_t
+  operator()(const coredd::detail::hashed_key& k)
+  const noexcept
+  {
+    return k.hash;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace std
@@ -57,6 +57,38 @@ set_deletion_handler(const handler_type<Unique>& h)
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Release a data of type Unique which is no longer referenced.
+///
+/// By default, the deletion handler of Unique is called. It can be specialized to bind the
+/// release of a Unique type at compile time, like basic_unicity does for its data, so ptr doesn't
+/// pay for the indirect call of a std::function and for the initialization check of a static.
+template <typename Unique>
+struct deletion_hook
+{
+  static
+  void
+  release(const Unique* x)
+  {
+    deletion_handler<Unique>()(x);
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tag to construct a ptr from a unified data without incrementing its reference counter.
+struct adopt_reference_t {};
+
+/// @brief Tag to construct a ptr from a unified data without incrementing its reference counter.
+constexpr adopt_reference_t adopt_reference{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Unique>
+class ptr_ref;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief A smart pointer to manage unified ressources.
 /// @tparam Unique the type of the unified ressource.
 ///
@@ -77,6 +109,19 @@ public:
     m_x->increment_reference_counter();
   }
 
+  /// @brief Constructor with a unified data which has already been referenced for this ptr.
+  ptr(Unique* p, adopt_reference_t)
+  noexcept
+    : m_x(p)
+  {}
+
+  /// @brief Constructor with a borrowed reference, which is then owned.
+  explicit
+  ptr(const ptr_ref<Unique>& x)
+  noexcept
+    : ptr(x.m_x)
+  {}
+
   /// @brief Copy constructor.
   ptr(const ptr& other)
   noexcept
@@ -94,10 +139,9 @@ public:
     assert(other.m_x != nullptr); // Don't copy from an already moved ptr.
     if (m_x != nullptr)
     {
-      m_x->decrement_reference_counter();
-      if (m_x->is_not_referenced())
+      if (m_x->decrement_reference_counter())
       {
-        deletion_handler<Unique>()(m_x);
+        deletion_hook<Unique>::release(m_x);
       }
     }
     m_x = other.m_x;
@@ -120,10 +164,9 @@ public:
   {
     if (m_x != nullptr)
     {
-      m_x->decrement_reference_counter();
-      if (m_x->is_not_referenced())
+      if (m_x->decrement_reference_counter())
       {
-        deletion_handler<Unique>()(m_x);
+        deletion_hook<Unique>::release(m_x);
       }
     }
     m_x = other.m_x;
@@ -136,10 +179,9 @@ public:
   {
     if (m_x != nullptr)
     {
-      m_x->decrement_reference_counter();
-      if (m_x->is_not_referenced())
+      if (m_x->decrement_reference_counter())
       {
-        deletion_handler<Unique>()(m_x);
+        deletion_hook<Unique>::release(m_x);
       }
     }
   }
@@ -216,12 +258,88 @@ public:
 
 private:
 
+  friend class ptr_ref<Unique>;
+
   /// @brief Pointer to the managed ressource, a unified data.
   Unique* m_x;
 };
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief A reference to a unified data borrowed from a ptr.
+/// @tparam Unique the type of the unified ressource.
+///
+/// It doesn't update the reference counter of the data, thus it must not outlive the ptr it was
+/// constructed from. It's meant to pass data known to be alive, for instance to build keys of
+/// cache lookups (see basic_cache::find()), which then don't copy ptrs. Its hash value is the one
+/// of the ptr, and it can be compared with ptrs. An owning ptr is constructed from it when the
+/// data must be kept.
+template <typename Unique>
+class ptr_ref
+{
+public:
+
+  /// @brief Borrow the data of a ptr.
+  ptr_ref(const ptr<Unique>& x)
+  noexcept
+    : m_x(x.m_x)
+  {
+    assert(x.m_x != nullptr); // Don't borrow from an already moved ptr.
+  }
+
+  /// @internal
+  /// @brief Get a pointer to the unified data.
+  const Unique*
+  operator->()
+  const noexcept
+  {
+    return m_x;
+  }
+
+  ///
+  template <typename T>
+  bool
+  is()
+  const noexcept
+  {
+    return detail::is<T>(m_x->data());
+  }
+
+  ///
+  template <typename T>
+  const T&
+  get()
+  const noexcept
+  {
+    return detail::variant_cast<T>(m_x->data());
+  }
+
+  friend
+  bool
+  operator==(const ptr_ref& lhs, const ptr_ref& rhs)
+  noexcept
+  {
+    return lhs.m_x == rhs.m_x;
+  }
+
+  friend
+  bool
+  operator<(const ptr_ref& lhs, const ptr_ref& rhs)
+  noexcept
+  {
+    return lhs.m_x < rhs.m_x;
+  }
+
+private:
+
+  friend class ptr<Unique>;
+
+  /// @brief Pointer to the borrowed ressource, a unified data.
+  Unique* m_x;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace coredd
 
 namespace std {
@@ -230,6 +348,9 @@ namespace std {
 
 /// @internal
 /// @brief Hash specialization for coredd::ptr
+///
+/// As unified data are unique, their addresses identify them. The address is mixed, as its low
+/// bits are always the same because of alignment.
 template <typename Unique>
 struct hash<coredd::ptr<Unique>>
 {
@@ -237,7 +358,22 @@ struct hash<coredd::ptr<Unique>>
   operator()(const coredd::ptr<Unique>& x)
   const noexcept
   {
-    return coredd::seed(x.operator->());
+    return coredd::hash_pointer(x.operator->());
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Hash specialization for coredd::ptr_ref, the same as the one of coredd::ptr.
+template <typename Unique>
+struct hash<coredd::ptr_ref<Unique>>
+{
+  std::size_t
+  operator()(const coredd::ptr_ref<Unique>& x)
+  const noexcept
+  {
+    return coredd::hash_pointer(x.operator->());
   }
 };
 
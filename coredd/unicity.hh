@@ -7,36 +7,102 @@
 #pragma once
 
 #include <cassert>
-#include <memory> // unique_ptr
+#include <cstdint>     // uint8_t
+#include <memory>      // unique_ptr
+#include <type_traits> // conditional, true_type, false_type
 
+#include "coredd/conf.hh"
+#include "coredd/detail/concurrent_unique_table.hh"
 #include "coredd/detail/unique.hh"
 #include "coredd/detail/unique_table.hh"
 #include "coredd/detail/variant.hh"
+#include "coredd/hash.hh"
+#include "coredd/lookup.hh"
 #include "coredd/ptr.hh"
 
 namespace coredd {
 
 /*------------------------------------------------------------------------------------------------*/
 
-template <typename... Ts>
-class unicity
+namespace detail {
+
+/// @internal
+/// @brief The unique table of a unicity.
+template <typename Unique, typename C>
+using unique_table_for = std::conditional_t< C::concurrent
+                                           , concurrent_unique_table<Unique, C>
+                                           , unique_table<Unique, C>>;
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Erase data of a unicity which are no longer referenced directly from its unique table.
+///
+/// The unique table is the one of the data itself if several unicities of the same type may exist
+/// (see unicity_conf::multiple_instances), or the one set by the last constructed unicity.
+template <typename C, typename... Ts>
+struct deletion_hook<detail::unique<detail::variant<Ts...>, C>>
+{
+  using unique_type = detail::unique<detail::variant<Ts...>, C>;
+  using unique_table_type = detail::unique_table_for<unique_type, C>;
+
+  /// @brief The unique table of the unicity of these data, set by basic_unicity.
+  static unique_table_type* table;
+
+  static
+  void
+  release(const unique_type* x)
+  noexcept
+  {
+    auto* t = C::multiple_instances ? static_cast<unique_table_type*>(x->owner()) : table;
+    assert(t != nullptr && "Unset unique table");
+    t->erase(x);
+  }
+};
+
+template <typename C, typename... Ts>
+detail::unique_table_for<detail::unique<detail::variant<Ts...>, C>, C>*
+deletion_hook<detail::unique<detail::variant<Ts...>, C>>::table = nullptr;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Unify data of types Ts.
+/// @tparam C The configuration, see unicity_conf.
+template <typename C, typename... Ts>
+class basic_unicity
 {
 private:
 
   using definition_type = detail::variant<Ts...>;
-  using unique_type = detail::unique<definition_type>;
-  using unique_table_type = detail::unique_table<unique_type>;
+  using unique_type = detail::unique<definition_type, C>;
+  using unique_table_type = detail::unique_table_for<unique_type, C>;
 
 public:
 
   using ptr_type = ptr<unique_type>;
+  using ptr_ref_type = ptr_ref<unique_type>;
 
 public:
 
-  unicity(std::size_t ut_size)
+  basic_unicity(std::size_t ut_size)
     : m_ut{std::make_unique<unique_table_type>(ut_size)}
   {
-    set_deletion_handler<unique_type>([this](const auto* u){m_ut->erase(u);});
+    if (not C::multiple_instances)
+    {
+      deletion_hook<unique_type>::table = m_ut.get();
+    }
+  }
+
+  basic_unicity(basic_unicity&&) = default;
+  basic_unicity& operator=(basic_unicity&&) = default;
+
+  /// @brief Destructor.
+  ~basic_unicity()
+  {
+    // Release data queued to this thread by other ones (see biased_reference_counter).
+    C::reference_counter::merge_pending();
   }
 
   template <typename T, typename... Args>
@@ -46,14 +112,47 @@ public:
     return make_sized<T>(sizeof(T), std::forward<Args>(args)...);
   }
 
+  /// @brief Unify a data of type T, constructed from args in a memory block of size bytes.
+  ///
+  /// If lookup<T> can hash and compare args, the data is first looked up and allocated and
+  /// constructed only if it doesn't exist yet.
   template <typename T, typename... Args>
   ptr_type
   make_sized(std::size_t size, Args&&... args)
   {
     assert(size >= sizeof(T));
-    auto* addr = m_ut->allocate(size);
-    auto* u = new (addr) unique_type{detail::construct<T>{}, std::forward<Args>(args)...};
-    return ptr_type{&(*m_ut)(u, size)};
+    C::reference_counter::merge_pending();
+    return make_sized_impl<T>( detail::has_lookup<T, Args...>{}, size
+                             , std::forward<Args>(args)...);
+  }
+
+  /// @brief Make a unified data immortal.
+  /// @return x
+  ///
+  /// The data is then never erased, and ptrs to it no longer update its reference counter. It's
+  /// meant for data referenced by almost all others, like the terminals of decision diagrams,
+  /// whose counters would otherwise be the most written memory of the process, and bounced between
+  /// cores when several threads share them. Immortal data are destroyed with the unicity, thus, as
+  /// for all other data, ptrs to them must not outlive it.
+  ptr_type
+  make_immortal(ptr_type x)
+  noexcept
+  {
+    // Unified data are exposed as const, but their reference counters are not part of them.
+    const_cast<unique_type*>(x.operator->())->make_immortal();
+    return x;
+  }
+
+  /// @brief Shrink the unique table to fit the number of unified data.
+  /// @return true if memory has been released.
+  ///
+  /// Meant to be called after a large number of data have been released, e.g. after a garbage
+  /// collection.
+  bool
+  compact()
+  noexcept
+  {
+    return m_ut->compact();
   }
 
   auto
@@ -63,6 +162,53 @@ public:
     return m_ut->stats();
   }
 
+  /// @brief Get the statistics of the unique table, with the longest chain of a sample of buckets.
+  auto
+  unique_table_stats(std::size_t nb_samples)
+  const noexcept
+  {
+    return m_ut->stats(nb_samples);
+  }
+
+private:
+
+  /// @brief Look the data up before constructing it.
+  template <typename T, typename... Args>
+  ptr_type
+  make_sized_impl(std::true_type, std::size_t size, Args&&... args)
+  {
+    // Must match the hash value of the variant holding the data.
+    const std::uint8_t index = detail::index_of<T, Ts...>::value;
+    const std::size_t hash = seed(lookup<T>::hash(args...)) (val(index));
+    auto* u = m_ut->find(hash, [&](const unique_type& x)
+                               {
+                                 return x.data().index == index
+                                    and lookup<T>::equal( detail::variant_cast<T>(x.data())
+                                                        , args...);
+                               });
+    if (u != nullptr)
+    {
+      return C::concurrent ? ptr_type{u, adopt_reference} : ptr_type{u};
+    }
+    return make_sized_impl<T>(std::false_type{}, size, std::forward<Args>(args)...);
+  }
+
+  /// @brief Construct the data, then unify it.
+  template <typename T, typename... Args>
+  ptr_type
+  make_sized_impl(std::false_type, std::size_t size, Args&&... args)
+  {
+    auto* addr = m_ut->allocate(size);
+    auto* u = new (addr) unique_type{detail::construct<T>{}, std::forward<Args>(args)...};
+    u->set_owner(m_ut.get());
+    if (C::concurrent)
+    {
+      // The concurrent unique table references the unified data on behalf of the returned ptr.
+      return ptr_type{&(*m_ut)(u, size), adopt_reference};
+    }
+    return ptr_type{&(*m_ut)(u, size)};
+  }
+
 private:
 
   std::unique_ptr<unique_table_type> m_ut;
@@ -70,4 +216,10 @@ private:
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Unify data of types Ts, using the default configuration.
+template <typename... Ts>
+using unicity = basic_unicity<unicity_conf, Ts...>;
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace coredd
@@ -8,7 +8,8 @@
 #include <memory> // unique_ptr
 #include <unordered_map>
 
-#include "coredd/cache.hh"
+#include "coredd/direct_cache.hh"
+#include "coredd/lookup.hh"
 #include "coredd/ptr.hh"
 #include "coredd/unicity.hh"
 #include "coredd/visit.hh"
@@ -66,7 +67,7 @@ struct Node
   operator==(const Node& lhs, const Node& rhs)
   noexcept
   {
-    return lhs.variable == rhs.variable and lhs.lo == rhs.lo and rhs.hi == rhs.hi;
+    return lhs.variable == rhs.variable and lhs.lo == rhs.lo and lhs.hi == rhs.hi;
   }
 };
 
@@ -93,6 +94,34 @@ struct hash<Node>
 
 /*------------------------------------------------------------------------------------------------*/
 
+namespace coredd {
+
+// Nodes are looked up from the arguments of make<Node>(), so an existing node is found without
+// allocating and constructing a new one.
+template <>
+struct lookup<Node>
+{
+  static
+  std::size_t
+  hash(int variable, const SimpleDD& lo, const SimpleDD& hi)
+  noexcept
+  {
+    return seed(variable) (val(lo)) (val(hi)); // same as std::hash<Node>
+  }
+
+  static
+  bool
+  equal(const Node& n, int variable, const SimpleDD& lo, const SimpleDD& hi)
+  noexcept
+  {
+    return n.variable == variable and n.lo == lo and n.hi == hi;
+  }
+};
+
+} // namespace coredd
+
+/*------------------------------------------------------------------------------------------------*/
+
 struct NbPathsVisitor
 {
   std::size_t
@@ -126,8 +155,8 @@ struct NbPathsVisitor
 /*------------------------------------------------------------------------------------------------*/
 
 auto unicity = Unicity{2048};
-const auto one = unicity.make<One>();
-const auto zero = unicity.make<Zero>();
+const auto one = unicity.make_immortal(unicity.make<One>());
+const auto zero = unicity.make_immortal(unicity.make<Zero>());
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -136,7 +165,8 @@ class Context
 {
 private:
 
-  using cache_type = coredd::cache<Context, Operation>;
+  // Operations on SimpleDD are short-lived and very frequent: a direct-mapped cache suits them.
+  using cache_type = coredd::direct_cache<Context, Operation>;
 
 public:
 
@@ -269,6 +299,22 @@ main()
   }
   assert(unicity.unique_table_stats().size == 2);
 
+  // Lookup
+  {
+    static_assert( coredd::detail::has_lookup<Node, int, SimpleDD, SimpleDD>::value
+                 , "Nodes should be looked up from their arguments");
+    const auto n0_1 = unicity.make<Node>(0, one, zero);
+    const auto n0_2 = unicity.make<Node>(0, one, one);
+    const auto hits = unicity.unique_table_stats().hits;
+    assert(not (n0_1 == n0_2));
+    assert(coredd::lookup<Node>::hash(0, one, zero) == std::hash<Node>()(n0_1.get<Node>()));
+    assert(unicity.make<Node>(0, one, zero) == n0_1);
+    assert(unicity.make<Node>(0, one, one) == n0_2);
+    assert(unicity.unique_table_stats().hits == hits + 2);
+    assert(unicity.unique_table_stats().size == 4);
+  }
+  assert(unicity.unique_table_stats().size == 2);
+
   // Visitor
   {
     const auto n0 = unicity.make<Node>(0, one, one);
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+
+#include "coredd/detail/clock_list.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace coredd::detail;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct foo
+{
+  int x;
+  clock_hook hook;
+
+  foo(int v)
+    : x(v), hook()
+  {}
+
+  clock_hook&
+  eviction_hook()
+  noexcept
+  {
+    return hook;
+  }
+};
+
+} // namespace anonymous
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(clock_list_test, second_chance)
+{
+  foo f0{0}, f1{1}, f2{2}, f3{3}, f4{4};
+  clock_list<foo> l{3};
+  ASSERT_TRUE(l.empty());
+  l.insert(&f0);
+  l.insert(&f1);
+  l.insert(&f2);
+
+  // Nothing has been used, the oldest element is evicted.
+  ASSERT_EQ(&f0, l.evict());
+  l.insert(&f3);
+
+  // f1 is given a second chance.
+  l.touch(&f1);
+  ASSERT_TRUE(f1.hook.referenced);
+  ASSERT_EQ(&f2, l.evict());
+  ASSERT_FALSE(f1.hook.referenced);
+  l.insert(&f4);
+
+  // The hand is after f4: f3 is met first, then f1.
+  ASSERT_EQ(&f3, l.evict());
+  l.insert(&f0);
+
+  // All elements are referenced, the hand goes all around the clock.
+  l.touch(&f0);
+  l.touch(&f1);
+  l.touch(&f4);
+  ASSERT_EQ(&f1, l.evict());
+  ASSERT_FALSE(f0.hook.referenced);
+  ASSERT_FALSE(f4.hook.referenced);
+
+  l.clear();
+  ASSERT_TRUE(l.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(clock_list_test, consecutive_evictions)
+{
+  foo f0{0}, f1{1}, f2{2}, f3{3}, f4{4}, f5{5};
+  clock_list<foo> l{4};
+  l.insert(&f0);
+  l.insert(&f1);
+  l.insert(&f2);
+  l.insert(&f3);
+
+  l.touch(&f1);
+  ASSERT_EQ(&f0, l.evict());
+  ASSERT_EQ(&f2, l.evict());
+  ASSERT_EQ(&f3, l.evict());
+  // Only f1 is left, its bit has been cleared by the hand.
+  ASSERT_EQ(&f1, l.evict());
+  ASSERT_TRUE(l.empty());
+
+  // The holes are filled, the last one first.
+  l.insert(&f4);
+  l.insert(&f5);
+  ASSERT_FALSE(l.empty());
+  // The hand is after the hole of f1, now filled by f4: f5 is met first.
+  ASSERT_EQ(&f5, l.evict());
+  ASSERT_EQ(&f4, l.evict());
+  ASSERT_TRUE(l.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
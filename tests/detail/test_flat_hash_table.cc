@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coredd/conf.hh"
+#include "coredd/detail/flat_hash_table.hh"
+
+using namespace coredd::detail;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct foo
+{
+  unsigned int data;
+  std::size_t hash;
+
+  foo(unsigned int d)
+    : data(d)
+    , hash(d)
+  {}
+
+  foo(unsigned int d, std::size_t h)
+    : data(d)
+    , hash(h)
+  {}
+
+  bool
+  operator==(const foo& other)
+  const noexcept
+  {
+    return data == other.data;
+  }
+};
+
+std::ostream&
+operator<<(std::ostream& os, const foo& f)
+{
+  return os << "foo(" << f.data <<")";
+}
+
+} // namespace anonymous
+
+namespace std
+{
+
+template <>
+struct hash<foo>
+{
+  std::size_t
+  operator()(const foo& f)
+  const noexcept
+  {
+    return f.hash;
+  }
+};
+
+} // namespace std
+
+using foo_hash_table = flat_hash_table<foo>;
+using foo_fixed_hash_table = flat_hash_table<foo, false>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, creation)
+{
+  foo_hash_table ht{100};
+  ASSERT_EQ(0u, ht.size());
+  ASSERT_EQ(128u, ht.bucket_count());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, simple_insertion)
+{
+  foo_hash_table  ht{10};
+
+  foo f1{42};
+  foo f2{42};
+  foo f3{43};
+
+  auto insertion = ht.insert(&f1);
+  ASSERT_EQ(1u, ht.size());
+  ASSERT_TRUE(insertion.second);
+  ASSERT_EQ(f1, *insertion.first);
+
+  insertion = ht.insert(&f2);
+  ASSERT_EQ(1u, ht.size());
+  ASSERT_FALSE(insertion.second);
+  ASSERT_EQ(&f1, insertion.first);
+
+  insertion = ht.insert(&f3);
+  ASSERT_EQ(2u, ht.size());
+  ASSERT_TRUE(insertion.second);
+  ASSERT_EQ(f3, *insertion.first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, insert_collision)
+{
+  // All elements have the same hash value, thus they share the same probe sequence.
+  std::vector<foo> vec;
+  vec.reserve(100);
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    vec.push_back(foo(i, 7));
+  }
+
+  foo_hash_table ht{16};
+  for (auto& f : vec)
+  {
+    ASSERT_TRUE(ht.insert(&f).second);
+  }
+  ASSERT_EQ(100u, ht.size());
+  ASSERT_LT(0u, ht.nb_rehash());
+
+  for (auto& f : vec)
+  {
+    foo g{f.data, 7};
+    ASSERT_EQ(&f, ht.insert(&g).first);
+  }
+
+  std::size_t col, alone, empty;
+  std::tie(col, alone, empty) = ht.collisions();
+  ASSERT_EQ(100u, col + alone);
+  ASSERT_EQ(ht.bucket_count() - 100u, empty);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, insert_check)
+{
+  foo_fixed_hash_table ht{10};
+  foo f1{33};
+  ht.insert(&f1);
+
+  const auto eq = [](unsigned int lhs, const foo& rhs){return lhs == rhs.data;};
+  foo_fixed_hash_table::insert_commit_data commit_data;
+
+  auto insertion = ht.insert_check(33u, eq, commit_data);
+  ASSERT_FALSE(insertion.second);
+  ASSERT_EQ(&f1, insertion.first);
+
+  insertion = ht.insert_check(42u, eq, commit_data);
+  ASSERT_TRUE(insertion.second);
+  ASSERT_EQ(1u, ht.size());
+
+  foo f2{42};
+  ht.insert_commit(&f2, commit_data);
+  ASSERT_EQ(2u, ht.size());
+
+  insertion = ht.insert_check(42u, eq, commit_data);
+  ASSERT_FALSE(insertion.second);
+  ASSERT_EQ(&f2, insertion.first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, erase)
+{
+  {
+    foo_hash_table ht{10};
+    foo f1{42};
+    ht.insert(&f1);
+    ASSERT_EQ(1u, ht.size());
+    ht.erase(&f1);
+    ASSERT_EQ(0u, ht.size());
+  }
+  {
+    // Fill the first group of the probe sequence to get deleted slots.
+    std::vector<foo> vec;
+    vec.reserve(40);
+    for (unsigned int i = 0; i < 40; ++i)
+    {
+      vec.push_back(foo(i, 0));
+    }
+    foo_hash_table ht{64};
+    for (auto& f : vec)
+    {
+      ht.insert(&f);
+    }
+    for (auto i = 0ul; i < vec.size(); i += 2)
+    {
+      ht.erase(&vec[i]);
+    }
+    ASSERT_EQ(20u, ht.size());
+    for (auto i = 0ul; i < vec.size(); ++i)
+    {
+      foo f{vec[i].data, 0};
+      const auto insertion = ht.insert(&f);
+      ASSERT_EQ(i % 2 == 0, insertion.second);
+      if (insertion.second)
+      {
+        ht.erase(&f);
+      }
+    }
+    ASSERT_EQ(20u, ht.size());
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, fixed_size_churn)
+{
+  // Simulate the behavior of a cache: the table never grows, while elements are continuously
+  // removed and inserted. Deleted slots must be reclaimed.
+  const auto eq = [](const foo& lhs, const foo& rhs){return lhs == rhs;};
+
+  foo_fixed_hash_table ht{64};
+  const auto max_size = ht.bucket_count() * 3 / 4;
+  std::vector<foo> vec;
+  vec.reserve(10000);
+  for (unsigned int i = 0; i < 10000; ++i)
+  {
+    vec.push_back(foo(i, i * 2654435761u));
+  }
+
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    if (ht.size() == max_size)
+    {
+      ht.erase(&vec[i - max_size]);
+    }
+    foo_fixed_hash_table::insert_commit_data commit_data;
+    ASSERT_TRUE(ht.insert_check(vec[i], eq, commit_data).second);
+    ht.insert_commit(&vec[i], commit_data);
+  }
+  ASSERT_EQ(max_size, ht.size());
+  ASSERT_EQ(64u, ht.bucket_count());
+  ASSERT_LT(0u, ht.nb_rehash());
+
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    foo_fixed_hash_table::insert_commit_data commit_data;
+    const auto insertion = ht.insert_check(vec[i], eq, commit_data);
+    ASSERT_EQ(i < vec.size() - max_size, insertion.second);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, cache_load_churn)
+{
+  // At the load of a full flat cache, deleted slots are reclaimed less than once per size
+  // insertions.
+  const auto eq = [](const foo& lhs, const foo& rhs){return lhs == rhs;};
+
+  using table = flat_hash_table<foo, false, coredd::flat_cache_conf::hash_policy>;
+  table ht{4096};
+  const std::size_t max_size = ht.bucket_count() * coredd::flat_cache_conf::max_load_factor;
+  const auto nb_insertions = 20 * ht.bucket_count();
+  std::vector<foo> vec;
+  vec.reserve(nb_insertions);
+  for (unsigned int i = 0; i < nb_insertions; ++i)
+  {
+    vec.push_back(foo(i));
+  }
+
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    if (ht.size() == max_size)
+    {
+      ht.erase(&vec[i - max_size]);
+    }
+    table::insert_commit_data commit_data;
+    ASSERT_TRUE(ht.insert_check(vec[i], eq, commit_data).second);
+    ht.insert_commit(&vec[i], commit_data);
+  }
+  ASSERT_GE(20u, ht.nb_rehash());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, clear_and_dispose)
+{
+  std::vector<foo> vec;
+  vec.reserve(16);
+  for (unsigned int i = 0; i < 16; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_hash_table ht{8};
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+
+  std::size_t cpt = 0;
+  ht.clear_and_dispose([&cpt](foo*){++cpt;});
+
+  ASSERT_EQ(0u, ht.size());
+  ASSERT_EQ(16u, cpt);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, compact)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i, i * 2654435761u});
+  }
+
+  foo_hash_table ht{16};
+  ASSERT_FALSE(ht.compact());
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+  const auto nb_slots = ht.bucket_count();
+  for (auto i = 5ul; i < vec.size(); ++i)
+  {
+    ht.erase(&vec[i]);
+  }
+  ASSERT_EQ(nb_slots, ht.bucket_count());
+
+  ASSERT_TRUE(ht.compact());
+  ASSERT_EQ(1u, ht.nb_shrink());
+  ASSERT_EQ(16u, ht.bucket_count());
+  ASSERT_FALSE(ht.compact());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    foo f{vec[i].data, vec[i].hash};
+    const auto insertion = ht.insert(&f);
+    ASSERT_EQ(i >= 5, insertion.second);
+    if (insertion.second)
+    {
+      ht.erase(&f);
+    }
+  }
+  ASSERT_EQ(5u, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, auto_shrink)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i, i * 2654435761u});
+  }
+
+  foo_hash_table ht{16, 0.75, 0.1};
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+  const auto nb_slots = ht.bucket_count();
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ht.erase(&vec[i]);
+    if (i == vec.size() * 9 / 10)
+    {
+      ASSERT_LT(0u, ht.nb_shrink());
+      ASSERT_GT(nb_slots, ht.bucket_count());
+      for (auto j = i + 1; j < vec.size(); ++j)
+      {
+        foo f{vec[j].data, vec[j].hash};
+        ASSERT_EQ(&vec[j], ht.insert(&f).first);
+      }
+    }
+  }
+  ASSERT_EQ(0u, ht.size());
+  ASSERT_EQ(16u, ht.bucket_count());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, collisions_counters)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    // Some hash values are shared to get collisions.
+    vec.push_back(foo{i, i % 300});
+  }
+
+  const auto check = [](const auto& ht)
+  {
+    // Sampling all slots gives the exact numbers.
+    std::size_t col, alone, empty, longest, sample_col, sample_alone, sample_empty;
+    std::tie(col, alone, empty) = ht.collisions();
+    std::tie(sample_col, sample_alone, sample_empty, longest) = ht.sample_collisions(~0ul);
+    ASSERT_EQ(sample_col, col);
+    ASSERT_EQ(sample_alone, alone);
+    ASSERT_EQ(sample_empty, empty);
+  };
+
+  foo_hash_table ht{16, 0.75, 0.1};
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+    check(ht);
+  }
+  for (auto i = 0ul; i < vec.size(); i += 3)
+  {
+    ht.erase(&vec[i]);
+    check(ht);
+  }
+
+  // Churn on a fixed-size table reorganizes slots in place.
+  const auto eq = [](const foo& lhs, const foo& rhs){return lhs == rhs;};
+  foo_fixed_hash_table fixed_ht{64};
+  const auto max_size = fixed_ht.bucket_count() * 3 / 4;
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    if (fixed_ht.size() == max_size)
+    {
+      fixed_ht.erase(&vec[i - max_size]);
+    }
+    foo_fixed_hash_table::insert_commit_data commit_data;
+    fixed_ht.insert_check(vec[i], eq, commit_data);
+    fixed_ht.insert_commit(&vec[i], commit_data);
+    check(fixed_ht);
+  }
+  ASSERT_LE(1u, fixed_ht.max_chain());
+
+  std::size_t col, alone, empty, longest;
+  std::tie(col, alone, empty, longest) = ht.sample_collisions(32);
+  ASSERT_EQ(ht.bucket_count(), col + alone + empty);
+
+  ht.clear_and_dispose([](foo*){});
+  std::tie(col, alone, empty) = ht.collisions();
+  ASSERT_EQ(ht.bucket_count(), empty);
+  ASSERT_EQ(0u, ht.max_chain());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(flat_hash_table, batched_lookup)
+{
+  std::vector<foo> vec;
+  vec.reserve(100);
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    // Some hash values are shared, so that several keys of a batch may aim at the same slot.
+    vec.push_back(foo{i, i % 10});
+  }
+  const auto eq = [](const foo& lhs, const foo& rhs){return lhs == rhs;};
+
+  foo_fixed_hash_table ht{256};
+  for (auto i = 0ul; i < vec.size(); i += 2)
+  {
+    ht.insert(&vec[i]);
+  }
+
+  std::vector<foo*> found(vec.size());
+  ht.find(vec.data(), vec.size(), eq, found.data());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ASSERT_EQ(i % 2 == 0 ? &vec[i] : nullptr, found[i]);
+  }
+
+  std::vector<foo_fixed_hash_table::insert_commit_data> commit_data(vec.size());
+  std::vector<std::pair<foo*, bool>> results(vec.size());
+  ht.insert_check(vec.data(), vec.size(), eq, commit_data.data(), results.data());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ASSERT_EQ(i % 2 != 0, results[i].second);
+    if (results[i].second)
+    {
+      ht.insert_commit(&vec[i], commit_data[i]);
+    }
+  }
+  ASSERT_EQ(100u, ht.size());
+  ht.find(vec.data(), vec.size(), eq, found.data());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ASSERT_EQ(&vec[i], found[i]);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
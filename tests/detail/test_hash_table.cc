@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <iostream>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -14,7 +15,14 @@ namespace /* anonymous */ {
 struct foo
 {
   unsigned int data;
-  intrusive_member_hook<foo> hook;
+  intrusive_member_hook<foo> m_hook;
+
+  intrusive_member_hook<foo>&
+  hook()
+  noexcept
+  {
+    return m_hook;
+  }
 
   foo(unsigned int d)
     : data(d)
@@ -45,7 +53,14 @@ struct bar
 {
   unsigned int data;
   std::size_t hash;
-  intrusive_member_hook<bar> hook;
+  intrusive_member_hook<bar> m_hook;
+
+  intrusive_member_hook<bar>&
+  hook()
+  noexcept
+  {
+    return m_hook;
+  }
 
   bar(unsigned int d, std::size_t h)
     : data(d)
@@ -73,6 +88,70 @@ operator<<(std::ostream& os, const bar& f)
   return os << "bar(" << f.data <<")";
 }
 
+struct baz
+{
+  static std::size_t nb_hash;
+
+  unsigned int data;
+  hashed_member_hook<baz> m_hook;
+
+  baz(unsigned int d)
+    : data(d)
+  {}
+
+  hashed_member_hook<baz>&
+  hook()
+  noexcept
+  {
+    return m_hook;
+  }
+
+  const hashed_member_hook<baz>&
+  hook()
+  const noexcept
+  {
+    return m_hook;
+  }
+
+  bool
+  operator==(const baz& other)
+  const noexcept
+  {
+    return data == other.data;
+  }
+};
+
+std::size_t baz::nb_hash = 0;
+
+struct qux
+{
+  static std::size_t nb_hook;
+
+  unsigned int data;
+  intrusive_member_hook<qux> m_hook;
+
+  qux(unsigned int d)
+    : data(d)
+  {}
+
+  intrusive_member_hook<qux>&
+  hook()
+  noexcept
+  {
+    ++nb_hook;
+    return m_hook;
+  }
+
+  bool
+  operator==(const qux& other)
+  const noexcept
+  {
+    return data == other.data;
+  }
+};
+
+std::size_t qux::nb_hook = 0;
+
 } // namespace anonymous
 
 namespace std
@@ -100,11 +179,36 @@ struct hash<bar>
   }
 };
 
+template <>
+struct hash<baz>
+{
+  std::size_t
+  operator()(const baz& b)
+  const noexcept
+  {
+    ++baz::nb_hash;
+    return b.data;
+  }
+};
+
+template <>
+struct hash<qux>
+{
+  std::size_t
+  operator()(const qux& q)
+  const noexcept
+  {
+    return q.data;
+  }
+};
+
 } // namespace std
 
 using foo_hash_table = hash_table<foo>;
 using foo_fixed_hash_table = hash_table<foo, false>;
 using bar_hash_table = hash_table<bar>;
+using foo_incremental_hash_table = hash_table<foo, true, true>;
+using baz_hash_table = hash_table<baz>;
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -228,6 +332,63 @@ TEST(hash_table, insert_check_hit)
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST(hash_table, insert_commit_after_modifications)
+{
+  std::vector<qux> vec;
+  vec.reserve(100);
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    vec.push_back(qux{i});
+  }
+  hash_table<qux, false> ht{16, 8}; // don't grow, chains of about 6 elements
+  for (auto& q : vec)
+  {
+    ht.insert(&q);
+  }
+  const auto eq = [](unsigned int lhs, const qux& rhs){return lhs == rhs.data;};
+
+  // As when a full cache discards an entry to make room for a new one: other buckets are
+  // modified between the check and the commit, the bucket of the new element is not walked again.
+  {
+    hash_table<qux, false>::insert_commit_data commit_data;
+    ASSERT_TRUE(ht.insert_check(104, eq, commit_data).second); // bucket 8, 6 elements
+    ht.erase(&vec[1]);
+    qux q1{1};
+    hash_table<qux, false>::insert_commit_data commit_data1;
+    ASSERT_TRUE(ht.insert_check(1, eq, commit_data1).second);
+    ht.insert_commit(&q1, commit_data1);
+
+    qux::nb_hook = 0;
+    qux q{104};
+    ht.insert_commit(&q, commit_data);
+    ASSERT_GT(6u, qux::nb_hook);
+    ASSERT_EQ(&q, ht.find(104u, eq));
+    ht.erase(&q);
+    ht.erase(&q1);
+    ht.insert(&vec[1]);
+  }
+
+  // The bucket itself has been modified: its last element, to which the commit would have
+  // appended the new element, has been removed.
+  {
+    hash_table<qux, false>::insert_commit_data commit_data;
+    ASSERT_TRUE(ht.insert_check(104, eq, commit_data).second);
+    ht.erase(&vec[8]);
+
+    qux::nb_hook = 0;
+    qux q{104};
+    ht.insert_commit(&q, commit_data);
+    ASSERT_LE(5u, qux::nb_hook);
+    ASSERT_EQ(&q, ht.find(104u, eq));
+    for (auto i = 24u; i < 100; i += 16)
+    {
+      ASSERT_EQ(&vec[i], ht.find(i, eq));
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST(hash_table, erase)
 {
   {
@@ -296,3 +457,558 @@ TEST(hash_table, clear_and_dispose)
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, incremental_rehash)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_incremental_hash_table ht{8};
+  bool seen_migration = false;
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ASSERT_TRUE(ht.insert(&vec[i]).second);
+    seen_migration = seen_migration or ht.migrating();
+    // All previously inserted elements must be found, wherever they are.
+    for (auto j = 0ul; j <= i; j += 37)
+    {
+      foo f{vec[j].data};
+      ASSERT_EQ(&vec[j], ht.insert(&f).first);
+    }
+  }
+  ASSERT_TRUE(seen_migration);
+  ASSERT_EQ(1000u, ht.size());
+  ASSERT_LT(0u, ht.nb_rehash());
+
+  std::size_t col, alone, empty;
+  std::tie(col, alone, empty) = ht.collisions();
+  ASSERT_LE(ht.bucket_count(), col + alone + empty);
+
+  // Erase while migrating.
+  for (auto i = 0ul; i < vec.size(); i += 2)
+  {
+    ht.erase(&vec[i]);
+  }
+  ASSERT_EQ(500u, ht.size());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    foo f{vec[i].data};
+    const auto insertion = ht.insert(&f);
+    ASSERT_EQ(i % 2 == 0, insertion.second);
+    if (insertion.second)
+    {
+      ht.erase(&f);
+    }
+  }
+  ASSERT_FALSE(ht.migrating());
+
+  std::size_t cpt = 0;
+  ht.clear_and_dispose([&cpt](foo*){++cpt;});
+  ASSERT_EQ(500u, cpt);
+  ASSERT_EQ(0u, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, incremental_rehash_erase_new_elements)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_incremental_hash_table ht{8};
+  std::vector<foo*> inserted_while_migrating;
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    const bool migrating = ht.migrating();
+    ASSERT_TRUE(ht.insert(&vec[i]).second);
+    if (migrating)
+    {
+      inserted_while_migrating.push_back(&vec[i]);
+    }
+    // Erase an element inserted during the current migration, before its bucket is migrated.
+    if (i % 3 == 0 and ht.migrating() and not inserted_while_migrating.empty())
+    {
+      ht.erase(inserted_while_migrating.back());
+      inserted_while_migrating.pop_back();
+    }
+  }
+  ASSERT_LT(0u, inserted_while_migrating.size());
+
+  // The remaining ones are erased later, during other migrations or after.
+  const auto size = ht.size();
+  for (auto x : inserted_while_migrating)
+  {
+    ht.erase(x);
+    ASSERT_EQ(nullptr, ht.find(*x, [](const foo& lhs, const foo& rhs){return lhs == rhs;}));
+  }
+  ASSERT_EQ(size - inserted_while_migrating.size(), ht.size());
+
+  std::size_t cpt = 0;
+  ht.clear_and_dispose([&cpt](foo*){++cpt;});
+  ASSERT_EQ(size - inserted_while_migrating.size(), cpt);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, stored_hash)
+{
+  static_assert(stores_hash<baz>::value, "");
+  static_assert(not stores_hash<foo>::value, "");
+
+  std::vector<baz> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(baz{i});
+  }
+
+  baz::nb_hash = 0;
+  baz_hash_table ht{8};
+  for (auto& b : vec)
+  {
+    ht.insert(&b);
+  }
+  ASSERT_LT(0u, ht.nb_rehash());
+  // Rehashing never computes a hash value.
+  ASSERT_EQ(1000u, baz::nb_hash);
+
+  for (auto& b : vec)
+  {
+    ASSERT_EQ(b.data, b.hook().hash);
+    ht.erase(&b);
+  }
+  ASSERT_EQ(0u, ht.size());
+  ASSERT_EQ(1000u, baz::nb_hash);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+/// @brief A hash policy which sets high bits, lost by packed hooks.
+struct high_bits_mixer
+{
+  std::size_t
+  operator()(std::size_t hash)
+  const noexcept
+  {
+    return hash | (~std::size_t{0} << 40);
+  }
+};
+
+} // namespace anonymous
+
+TEST(hash_table, truncated_hash)
+{
+  // Data are placed with the hash value kept by their hook, whether it's computed from a key or
+  // read from the hook.
+  std::vector<baz> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(baz{i});
+  }
+  hash_table<baz, true, false, false, high_bits_mixer> ht{8};
+  for (auto& b : vec)
+  {
+    ht.insert(&b);
+    ASSERT_EQ((mixed_hash<baz, high_bits_mixer>(b)), hash_of<high_bits_mixer>(b));
+  }
+  for (auto& b : vec)
+  {
+    ht.erase(&b);
+  }
+  ASSERT_EQ(0u, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, compact)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_hash_table ht{16};
+  ASSERT_FALSE(ht.compact());
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+  const auto nb_buckets = ht.bucket_count();
+  for (auto i = 5ul; i < vec.size(); ++i)
+  {
+    ht.erase(&vec[i]);
+  }
+  // No automatic shrink by default.
+  ASSERT_EQ(nb_buckets, ht.bucket_count());
+
+  ASSERT_TRUE(ht.compact());
+  ASSERT_EQ(1u, ht.nb_shrink());
+  ASSERT_EQ(16u, ht.bucket_count());
+  ASSERT_FALSE(ht.compact());
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    foo f{vec[i].data};
+    const auto insertion = ht.insert(&f);
+    ASSERT_EQ(i >= 5, insertion.second);
+    if (insertion.second)
+    {
+      ht.erase(&f);
+    }
+  }
+  ASSERT_EQ(5u, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, auto_shrink)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_incremental_hash_table ht{16, 0.75, 0.1};
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+  const auto nb_buckets = ht.bucket_count();
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ht.erase(&vec[i]);
+    // Once shrunk, the load factor is about half the maximal one. As the table shrinks
+    // incrementally, it may go below the minimal one until the migration is over.
+    ASSERT_TRUE( ht.size() == 0 or ht.load_factor() >= 0.1 or ht.bucket_count() == 16
+               or ht.migrating());
+    if (i == vec.size() * 9 / 10)
+    {
+      ASSERT_LT(0u, ht.nb_shrink());
+      ASSERT_GT(nb_buckets, ht.bucket_count());
+      for (auto j = i + 1; j < vec.size(); ++j)
+      {
+        foo f{vec[j].data};
+        ASSERT_EQ(&vec[j], ht.insert(&f).first);
+      }
+    }
+  }
+  ASSERT_EQ(0u, ht.size());
+  ASSERT_EQ(16u, ht.bucket_count());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, incremental_shrink)
+{
+  std::vector<foo> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+
+  foo_incremental_hash_table ht{16, 0.75, 0.1};
+  for (auto& f : vec)
+  {
+    ht.insert(&f);
+  }
+  ht.compact(); // finish the last growth
+  ASSERT_FALSE(ht.migrating());
+
+  auto i = 0ul;
+  for (; ht.nb_shrink() == 0; ++i)
+  {
+    ht.erase(&vec[i]);
+  }
+  // The erasure which triggered the shrink didn't move all elements.
+  ASSERT_TRUE(ht.migrating());
+  const auto nb_buckets = ht.bucket_count();
+  for (; ht.migrating(); ++i)
+  {
+    ht.erase(&vec[i]);
+    ASSERT_EQ(nb_buckets, ht.bucket_count());
+    for (auto j = i + 1; j < vec.size(); ++j)
+    {
+      foo f{vec[j].data};
+      ASSERT_EQ(&vec[j], ht.find(f, [](const foo& lhs, const foo& rhs){return lhs == rhs;}));
+    }
+  }
+  ASSERT_EQ(1u, ht.nb_shrink());
+  ASSERT_EQ(vec.size() - i, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+TEST(hash_table, load_factors_bounds)
+{
+  // The table would grow again as soon as it has shrunk.
+  ASSERT_DEATH(foo_incremental_hash_table(16, 0.75, 0.4), "");
+}
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, collisions_counters)
+{
+  std::vector<bar> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    // Some hash values are shared to get collisions.
+    vec.push_back(bar{i, i % 300});
+  }
+
+  const auto check = [](const auto& ht)
+  {
+    // Sampling all buckets gives the exact numbers.
+    std::size_t col, alone, empty, longest, sample_col, sample_alone, sample_empty;
+    std::tie(col, alone, empty) = ht.collisions();
+    std::tie(sample_col, sample_alone, sample_empty, longest) = ht.sample_collisions(~0ul);
+    ASSERT_EQ(sample_col, col);
+    ASSERT_EQ(sample_alone, alone);
+    ASSERT_EQ(sample_empty, empty);
+  };
+
+  // Elements can't be shared by two intrusive tables.
+  auto incremental_vec = vec;
+  bar_hash_table ht{16, 0.75, 0.1};
+  hash_table<bar, true, true> incremental_ht{16};
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ht.insert(&vec[i]);
+    incremental_ht.insert(&incremental_vec[i]);
+    check(ht);
+  }
+  ASSERT_LE(2u, ht.max_chain());
+  for (auto i = 0ul; i < vec.size(); i += 3)
+  {
+    ht.erase(&vec[i]);
+    check(ht);
+  }
+
+  // While migrating, old buckets must be taken into account.
+  std::size_t col, alone, empty;
+  for (auto i = 0ul; i < vec.size(); i += 3)
+  {
+    incremental_ht.erase(&incremental_vec[i]);
+    std::tie(col, alone, empty) = incremental_ht.collisions();
+    ASSERT_LE(incremental_ht.bucket_count(), col + alone + empty);
+    ASSERT_LE(col + alone, incremental_ht.size());
+  }
+  check(incremental_ht);
+
+  std::size_t longest;
+  std::tie(col, alone, empty, longest) = ht.sample_collisions(16);
+  ASSERT_EQ(ht.bucket_count(), col + alone + empty);
+
+  ht.clear_and_dispose([](bar*){});
+  std::tie(col, alone, empty) = ht.collisions();
+  ASSERT_EQ(ht.bucket_count(), empty);
+  ASSERT_EQ(0u, ht.max_chain());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, max_chain)
+{
+  // All elements in the same bucket, with different summary bits.
+  std::vector<bar> vec;
+  vec.reserve(20);
+  for (unsigned int i = 0; i < 20; ++i)
+  {
+    vec.push_back(bar{i, i * 64});
+  }
+  const auto check = [](const auto& ht)
+  {
+    std::size_t col, alone, empty, longest;
+    std::tie(col, alone, empty, longest) = ht.sample_collisions(0);
+    ASSERT_EQ(ht.size(), longest);
+    if (bucket<bar>::tagged)
+    {
+      // Insertions rejected by the summary know that the chain is not empty.
+      ASSERT_LE(std::min(ht.size(), 2ul), ht.max_chain());
+      ASSERT_GE(longest, ht.max_chain());
+    }
+    else
+    {
+      ASSERT_EQ(longest, ht.max_chain());
+    }
+  };
+
+  // Elements can't be shared by two intrusive tables.
+  auto fixed_vec = vec;
+  bar_hash_table ht{64};
+  hash_table<bar, false> fixed_ht{64};
+  for (auto i = 0ul; i < vec.size(); ++i)
+  {
+    ht.insert(&vec[i]);
+    hash_table<bar, false>::insert_commit_data commit_data;
+    const auto insertion = fixed_ht.insert_check( fixed_vec[i]
+                                                , [](const bar& lhs, const bar& rhs)
+                                                    {
+                                                      return lhs == rhs;
+                                                    }
+                                                , commit_data);
+    ASSERT_TRUE(insertion.second);
+    fixed_ht.insert_commit(&fixed_vec[i], commit_data);
+    check(ht);
+    check(fixed_ht);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, batched_lookup)
+{
+  std::vector<foo> vec;
+  vec.reserve(100);
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    vec.push_back(foo{i});
+  }
+  const auto eq = [](unsigned int lhs, const foo& rhs){return lhs == rhs.data;};
+
+  foo_fixed_hash_table ht{32};
+  for (auto i = 0ul; i < vec.size(); i += 2)
+  {
+    ht.insert(&vec[i]);
+  }
+
+  std::vector<unsigned int> keys;
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    keys.push_back(i);
+  }
+  std::vector<foo*> found(keys.size());
+  ht.find(keys.data(), keys.size(), eq, found.data());
+  for (auto i = 0ul; i < keys.size(); ++i)
+  {
+    ASSERT_EQ(i % 2 == 0 ? &vec[i] : nullptr, found[i]);
+  }
+
+  std::vector<foo_fixed_hash_table::insert_commit_data> commit_data(keys.size());
+  std::vector<std::pair<foo*, bool>> results(keys.size());
+  ht.insert_check(keys.data(), keys.size(), eq, commit_data.data(), results.data());
+  for (auto i = 0ul; i < keys.size(); ++i)
+  {
+    ASSERT_EQ(i % 2 != 0, results[i].second);
+    if (results[i].second)
+    {
+      ht.insert_commit(&vec[i], commit_data[i]);
+    }
+  }
+  ASSERT_EQ(100u, ht.size());
+  ht.find(keys.data(), keys.size(), eq, found.data());
+  for (auto i = 0ul; i < keys.size(); ++i)
+  {
+    ASSERT_EQ(&vec[i], found[i]);
+  }
+
+  // Keys may also be looked for while an incremental rehash is in progress.
+  std::vector<foo> other_vec(vec.begin(), vec.end());
+  foo_incremental_hash_table incremental_ht{8};
+  for (auto& f : other_vec)
+  {
+    incremental_ht.insert(&f);
+  }
+  ASSERT_TRUE(incremental_ht.migrating());
+  incremental_ht.find(keys.data(), keys.size(), eq, found.data());
+  for (auto i = 0ul; i < keys.size(); ++i)
+  {
+    ASSERT_EQ(&other_vec[i], found[i]);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(hash_table, bucket_summary)
+{
+  static_assert(sizeof(bucket<foo>) == sizeof(foo*), "");
+
+  bar b0{0, 0};
+  bar_hash_table ht{1, 2.0};
+  ht.insert(&b0);
+  ASSERT_EQ(1u, ht.bucket_count());
+
+  std::size_t nb_comparisons = 0;
+  const auto eq = [&](const bar& lhs, const bar& rhs)
+  {
+    ++nb_comparisons;
+    return lhs == rhs;
+  };
+  std::vector<bar> keys;
+  for (unsigned int i = 1; i < 100; ++i)
+  {
+    keys.push_back(bar{i, i});
+  }
+  std::vector<bar*> found(keys.size());
+  ht.find(keys.data(), keys.size(), eq, found.data());
+  ASSERT_TRUE(std::all_of(found.begin(), found.end(), [](bar* x){return x == nullptr;}));
+  if (bucket<bar>::tagged)
+  {
+    // Most missing keys are rejected without looking at the only element.
+    ASSERT_GT(keys.size() / 4, nb_comparisons);
+  }
+  else
+  {
+    ASSERT_EQ(keys.size(), nb_comparisons);
+  }
+
+  bar b1{0, 0};
+  ASSERT_EQ(&b0, ht.insert(&b1).first);
+  ht.erase(&b0);
+  ASSERT_EQ(0u, ht.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Hash>
+std::size_t
+nb_collisions_of_aligned_keys()
+{
+  // Keys which look like aligned addresses: their low bits are always 0.
+  std::vector<bar> vec;
+  vec.reserve(1000);
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(bar{i, 0x7f0000000000ul + i * 64});
+  }
+  hash_table<bar, true, false, false, Hash> ht{2048};
+  for (auto& b : vec)
+  {
+    ht.insert(&b);
+  }
+  for (auto& b : vec)
+  {
+    bar other{b.data, b.hash};
+    EXPECT_EQ(&b, ht.insert(&other).first);
+  }
+  EXPECT_EQ(0u, ht.nb_rehash());
+  return std::get<0>(ht.collisions());
+}
+
+TEST(hash_table, hash_policy)
+{
+  // Only 1/64 of the buckets are used without mixing.
+  ASSERT_LT(30u, nb_collisions_of_aligned_keys<coredd::identity_mixer>());
+  ASSERT_GT(250u, nb_collisions_of_aligned_keys<coredd::xxh3_mixer>());
+  ASSERT_GT(250u, nb_collisions_of_aligned_keys<coredd::wyhash_mixer>());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
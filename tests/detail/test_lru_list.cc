@@ -0,0 +1,79 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coredd/detail/lru_list.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace coredd::detail;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct foo
+{
+  int x;
+  coredd::detail::lru_hook<foo> hook;
+
+  foo(int v)
+    : x(v), hook()
+  {}
+
+  coredd::detail::lru_hook<foo>&
+  eviction_hook()
+  noexcept
+  {
+    return hook;
+  }
+};
+
+/// @brief Get the elements of a list, from the least to the most recently used.
+std::vector<int>
+elements(const lru_list<foo>& l)
+{
+  std::vector<int> res;
+  if (not l.empty())
+  {
+    for (auto x = l.front(); x != nullptr; x = x->hook.next)
+    {
+      res.push_back(x->x);
+    }
+  }
+  return res;
+}
+
+} // namespace anonymous
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(lru_list_test, order)
+{
+  foo f0{0}, f1{1}, f2{2};
+  lru_list<foo> l;
+  ASSERT_TRUE(l.empty());
+  l.insert(&f0);
+  l.insert(&f1);
+  l.insert(&f2);
+  ASSERT_EQ((std::vector<int>{0, 1, 2}), elements(l));
+  l.touch(&f0);
+  ASSERT_EQ((std::vector<int>{1, 2, 0}), elements(l));
+  l.touch(&f2);
+  ASSERT_EQ((std::vector<int>{1, 0, 2}), elements(l));
+  l.touch(&f2);
+  ASSERT_EQ((std::vector<int>{1, 0, 2}), elements(l));
+  ASSERT_EQ(&f1, l.front());
+  ASSERT_EQ(&f1, l.evict());
+  ASSERT_EQ((std::vector<int>{0, 2}), elements(l));
+  l.erase(&f2);
+  ASSERT_EQ((std::vector<int>{0}), elements(l));
+  ASSERT_EQ(&f0, l.evict());
+  ASSERT_TRUE(l.empty());
+  l.insert(&f1);
+  ASSERT_EQ((std::vector<int>{1}), elements(l));
+  l.clear();
+  ASSERT_TRUE(l.empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
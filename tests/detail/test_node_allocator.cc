@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coredd/detail/node_allocator.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace coredd::detail;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(slab_allocator_test, size_classes)
+{
+  slab_allocator a;
+  const auto p1 = a.allocate(1);
+  const auto p2 = a.allocate(16);
+  const auto p3 = a.allocate(17);
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(p1) % alignof(std::max_align_t));
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(p3) % alignof(std::max_align_t));
+  // Blocks of the same class are contiguous in a new chunk.
+  ASSERT_EQ(p1 + 16, p2);
+  ASSERT_EQ(16u + 16u + 32u, a.stats().used);
+  a.deallocate(p2);
+  ASSERT_EQ(16u + 32u, a.stats().used);
+  // The freed block is reused first.
+  ASSERT_EQ(p2, a.allocate(9));
+  a.deallocate(p1);
+  a.deallocate(p2);
+  a.deallocate(p3);
+  ASSERT_EQ(0u, a.stats().used);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(slab_allocator_test, large_blocks)
+{
+  slab_allocator a;
+  const auto size = slab_allocator::max_block_size + 1;
+  const auto p = a.allocate(size);
+  std::memset(p, 0xff, size);
+  ASSERT_EQ(size, a.stats().used);
+  ASSERT_EQ(0u, a.stats().wasted);
+  a.deallocate(p);
+  ASSERT_EQ(0u, a.stats().used);
+  ASSERT_LT(size, a.stats().returned);
+  // It didn't take a whole chunk.
+  ASSERT_GT(2 * size, a.stats().returned);
+
+  // Large and small blocks deallocated in any order.
+  std::vector<char*> blocks;
+  for (auto i = 0ul; i < 100; ++i)
+  {
+    blocks.push_back(a.allocate(i % 2 == 0 ? 64 : 4 * size));
+  }
+  for (auto i = 0ul; i < blocks.size(); i += 3)
+  {
+    a.deallocate(blocks[i]);
+  }
+  for (auto i = 0ul; i < blocks.size(); ++i)
+  {
+    if (i % 3 != 0)
+    {
+      a.deallocate(blocks[i]);
+    }
+  }
+  ASSERT_EQ(0u, a.stats().used);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+TEST(slab_allocator_test, live_blocks)
+{
+  // The memory of blocks still in use would be released.
+  ASSERT_DEATH({slab_allocator a; a.allocate(16);}, "");
+}
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(key_set_test, insert_erase)
+{
+  key_set set;
+  ASSERT_FALSE(set.contains(1));
+  const auto nb = 1000u;
+  for (auto i = 1u; i <= nb; ++i)
+  {
+    set.reserve_one();
+    set.insert(i * 7);
+  }
+  for (auto i = 1u; i <= nb; i += 2)
+  {
+    set.erase(i * 7);
+  }
+  for (auto i = 1u; i <= nb; ++i)
+  {
+    ASSERT_EQ(i % 2 == 0, set.contains(i * 7));
+    ASSERT_FALSE(set.contains(i * 7 + 1));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(slab_allocator_test, release_chunks)
+{
+  slab_allocator a;
+  std::vector<char*> blocks;
+  // Enough blocks to fill several chunks.
+  const auto nb = 4 * slab_allocator::chunk_size / 64;
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    blocks.push_back(a.allocate(64));
+    std::memset(blocks.back(), static_cast<int>(i), 64);
+  }
+  ASSERT_EQ(nb * 64, a.stats().used);
+  ASSERT_EQ(0u, a.stats().returned);
+  for (auto b : blocks)
+  {
+    a.deallocate(b);
+  }
+  ASSERT_EQ(0u, a.stats().used);
+  // All chunks but one have been returned as soon as they were empty.
+  ASSERT_LE(3 * slab_allocator::chunk_size, a.stats().returned);
+  ASSERT_LT(0u, a.stats().wasted);
+  a.release();
+  ASSERT_EQ(0u, a.stats().wasted);
+  // The allocator can still be used after a release.
+  a.deallocate(a.allocate(64));
+}
+
+/*------------------------------------------------------------------------------------------------*/
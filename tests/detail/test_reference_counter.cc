@@ -0,0 +1,166 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coredd/detail/reference_counter.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+/// @brief A data which records its release.
+template <typename Counter>
+struct data
+{
+  Counter counter;
+  bool released = false;
+};
+
+} // namespace anonymous
+
+namespace coredd {
+
+template <typename Counter>
+struct deletion_hook<data<Counter>>
+{
+  static
+  void
+  release(const data<Counter>* x)
+  {
+    const_cast<data<Counter>*>(x)->released = true;
+  }
+};
+
+} // namespace coredd
+
+using namespace coredd::detail;
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Counter>
+struct reference_counter_test
+  : public testing::Test
+{};
+
+using counters = testing::Types< plain_reference_counter, atomic_reference_counter
+                               , biased_reference_counter>;
+TYPED_TEST_CASE(reference_counter_test, counters);
+
+/*------------------------------------------------------------------------------------------------*/
+
+TYPED_TEST(reference_counter_test, single_thread)
+{
+  data<TypeParam> d;
+  auto& c = d.counter;
+  ASSERT_TRUE(c.is_zero());
+  c.increment();
+  ASSERT_FALSE(c.is_zero());
+  ASSERT_TRUE(c.try_increment());
+  ASSERT_FALSE(c.decrement(&d));
+  ASSERT_TRUE(c.decrement(&d));
+  ASSERT_TRUE(c.is_zero());
+  ASSERT_FALSE(c.try_increment());
+  // Revive the counter, as a unique table does with dead data.
+  c.increment();
+  ASSERT_FALSE(c.is_zero());
+  ASSERT_TRUE(c.decrement(&d));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TYPED_TEST(reference_counter_test, immortal)
+{
+  data<TypeParam> d;
+  auto& c = d.counter;
+  c.increment();
+  ASSERT_FALSE(c.is_immortal());
+  c.make_immortal();
+  ASSERT_TRUE(c.is_immortal());
+  ASSERT_FALSE(c.decrement(&d));
+  ASSERT_FALSE(c.decrement(&d));
+  ASSERT_FALSE(c.is_zero());
+  ASSERT_TRUE(c.try_increment());
+  c.increment();
+  ASSERT_FALSE(c.decrement(&d));
+  ASSERT_TRUE(c.is_immortal());
+  ASSERT_FALSE(d.released);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(biased_reference_counter_test, other_threads)
+{
+  data<biased_reference_counter> d;
+  auto& c = d.counter;
+  c.increment();
+  c.increment();
+  const auto nb_threads = 4u;
+  const auto nb_references = 100000u;
+  {
+    std::vector<std::thread> threads;
+    for (auto t = 0u; t < nb_threads; ++t)
+    {
+      threads.emplace_back([&]
+      {
+        for (auto i = 0u; i < nb_references; ++i)
+        {
+          c.increment();
+          ASSERT_TRUE(c.try_increment());
+          ASSERT_FALSE(c.decrement(&d));
+          ASSERT_FALSE(c.decrement(&d));
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+  }
+  ASSERT_FALSE(c.decrement(&d));
+  ASSERT_FALSE(c.is_zero());
+
+  // Another thread drops the last reference, taken by the owner: the data is queued to its owner.
+  bool last = true;
+  std::thread{[&]{last = c.decrement(&d);}}.join();
+  ASSERT_FALSE(last);
+  ASSERT_TRUE(c.is_zero());
+  ASSERT_FALSE(d.released);
+  biased_reference_counter::merge_pending();
+  ASSERT_TRUE(d.released);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(biased_reference_counter_test, owner_drops_last)
+{
+  data<biased_reference_counter> d;
+  auto& c = d.counter;
+  c.increment();
+  std::thread{[&]{c.increment();}}.join();
+  bool last = true;
+  std::thread{[&]{last = c.decrement(&d);}}.join();
+  ASSERT_FALSE(last);
+  ASSERT_TRUE(c.decrement(&d));
+  ASSERT_TRUE(c.is_zero());
+  bool revived = true;
+  std::thread{[&]{revived = c.try_increment();}}.join();
+  ASSERT_FALSE(revived);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(biased_reference_counter_test, owner_exited)
+{
+  std::unique_ptr<data<biased_reference_counter>> d;
+  std::thread{[&]
+  {
+    d = std::make_unique<data<biased_reference_counter>>();
+    d->counter.increment();
+  }}.join();
+  // The owner is gone, the last reference is dropped by another thread.
+  ASSERT_TRUE(d->counter.decrement(d.get()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,8 +1,11 @@
 #include "gtest/gtest.h"
 
+#include <random>
 #include <stdexcept>
+#include <vector>
 
 #include "coredd/cache.hh"
+#include "coredd/direct_cache.hh"
 
 using namespace coredd;
 
@@ -316,3 +319,573 @@ TEST(cache, exception)
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, flat_backend)
+{
+  basic_cache<flat_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(1000u, stats.hits);
+  ASSERT_EQ(1000u, stats.misses);
+  ASSERT_LT(0u, stats.discarded);
+  ASSERT_EQ(1000u - stats.discarded, c.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, front_insertion)
+{
+  basic_cache<front_insertion_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(1000u, stats.hits);
+  ASSERT_EQ(1000u, stats.misses);
+  ASSERT_LT(0u, stats.discarded);
+  ASSERT_EQ(1000u - stats.discarded, c.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, clock_eviction)
+{
+  basic_cache<clock_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    // An operation used between two passes of the hand is never discarded.
+    ASSERT_EQ(1u, c(operation(0)));
+  }
+  ASSERT_EQ(1000u, stats.hits);
+  ASSERT_EQ(1000u, stats.misses);
+  ASSERT_LT(0u, stats.discarded);
+  ASSERT_EQ(1000u - stats.discarded, c.size());
+  ASSERT_DOUBLE_EQ(0.5, c.statistics().hit_ratio);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, batch_eviction)
+{
+  basic_cache<batch_eviction_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  // Fill the cache.
+  auto i = 0ul;
+  for (; stats.eviction_batches == 0; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  const auto max_size = i - 1;
+  ASSERT_EQ(1u, stats.eviction_batches);
+  ASSERT_EQ(max_size / 2, stats.discarded);
+  ASSERT_EQ(max_size - max_size / 2 + 1, c.size());
+
+  // The most recently used operations are kept.
+  ASSERT_EQ(i, c(operation(i - 1)));
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(1u, c(operation(0)));
+  ASSERT_EQ(1u, stats.hits);
+
+  for (auto j = 0ul; j < 1000; ++j)
+  {
+    c(operation(1000 + j));
+    ASSERT_LE(c.size(), max_size);
+  }
+  ASSERT_EQ(stats.discarded, stats.eviction_batches * (max_size / 2));
+  ASSERT_LT(0, c.statistics().eviction_time.count());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct batch_clock_cache_conf
+  : public clock_cache_conf
+{
+  static constexpr double eviction_ratio = 0.5;
+};
+
+TEST(cache, batch_clock_eviction)
+{
+  basic_cache<batch_clock_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    ASSERT_EQ(1u, c(operation(0)));
+  }
+  ASSERT_EQ(1000u, stats.hits);
+  ASSERT_EQ(1000u, stats.misses);
+  ASSERT_LT(1u, stats.eviction_batches);
+  ASSERT_EQ(1000u - stats.discarded, c.size());
+  // The referenced operation survives the batches.
+  ASSERT_NE(nullptr, c.find(operation(0)));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct hashed_cache_conf
+  : public cache_conf
+{
+  static constexpr bool store_hash = true;
+};
+
+TEST(cache, stored_hash)
+{
+  basic_cache<hashed_cache_conf, context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(1000u, stats.hits);
+  ASSERT_EQ(1000u, stats.misses);
+  ASSERT_EQ(1000u - stats.discarded, c.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Cache>
+void
+check_batched_lookup(Cache& c)
+{
+  const auto& stats = c.statistics();
+  for (auto i = 0ul; i < 20; i += 2)
+  {
+    c(operation(i));
+  }
+
+  std::vector<operation> ops;
+  for (auto i = 0ul; i < 20; ++i)
+  {
+    ops.emplace_back(i);
+  }
+  std::vector<const std::size_t*> results(ops.size());
+  c.lookup(ops.data(), ops.size(), results.data());
+  for (auto i = 0ul; i < 20; ++i)
+  {
+    if (i % 2 == 0)
+    {
+      ASSERT_NE(nullptr, results[i]);
+      ASSERT_EQ(i + 1, *results[i]);
+    }
+    else
+    {
+      ASSERT_EQ(nullptr, results[i]);
+    }
+  }
+  ASSERT_EQ(10u, stats.hits);
+  ASSERT_EQ(10u, stats.misses);
+}
+
+TEST(cache, batched_lookup)
+{
+  {
+    cache<context, operation> c(cxt, 100);
+    check_batched_lookup(c);
+  }
+  {
+    basic_cache<flat_cache_conf, context, operation> c(cxt, 100);
+    check_batched_lookup(c);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A key which looks an operation up without being one.
+struct operation_key
+{
+  std::size_t i;
+
+  friend
+  bool
+  operator==(const operation_key& lhs, const operation& rhs)
+  noexcept
+  {
+    return lhs.i == rhs.i_;
+  }
+};
+
+namespace std {
+
+template <>
+struct hash<operation_key>
+{
+  std::size_t
+  operator()(const operation_key& k)
+  const noexcept
+  {
+    return std::hash<operation>()(operation{k.i});
+  }
+};
+
+} // namespace std
+
+template <typename Cache>
+void
+check_find(Cache& c)
+{
+  const auto& stats = c.statistics();
+  ASSERT_EQ(nullptr, c.find(operation_key{1}));
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(0u, stats.hits);
+  ASSERT_EQ(1u, stats.misses);
+  const auto* res = c.find(operation_key{1});
+  ASSERT_NE(nullptr, res);
+  ASSERT_EQ(2u, *res);
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(1u, stats.misses);
+  ASSERT_EQ(nullptr, c.find(operation_key{2}));
+  ASSERT_EQ(1u, stats.hits);
+}
+
+TEST(cache, find)
+{
+  {
+    cache<context, operation> c(cxt, 100);
+    check_find(c);
+  }
+  {
+    basic_cache<flat_cache_conf, context, operation> c(cxt, 100);
+    check_find(c);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, sampled_statistics)
+{
+  cache<context, operation> c(cxt, 100);
+  for (auto i = 0ul; i < 50; ++i)
+  {
+    c(operation(i));
+  }
+  ASSERT_EQ(0u, c.statistics().longest_chain);
+  const auto longest = c.statistics(~0ul).longest_chain;
+  ASSERT_LE(1u, longest);
+  ASSERT_GE(50u, longest);
+  ASSERT_EQ(50u, c.statistics(16).size);
+  ASSERT_EQ(0u, c.statistics().longest_chain);
+
+  basic_cache<flat_cache_conf, context, operation> f(cxt, 100);
+  f(operation(0));
+  ASSERT_EQ(1u, f.statistics(~0ul).longest_chain);
+
+  direct_cache<context, operation> d(cxt, 100);
+  ASSERT_EQ(1u, d.statistics(16).longest_chain);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, resize)
+{
+  cache<context, operation> c(cxt, 100);
+  const auto& stats = c.statistics();
+  const auto initial_capacity = c.statistics().capacity;
+
+  for (auto i = 0ul; i < 50; ++i)
+  {
+    c(operation(i));
+  }
+
+  // Growing keeps entries.
+  c.resize(1000);
+  ASSERT_LT(initial_capacity, c.statistics().capacity);
+  ASSERT_EQ(1u, stats.resizes);
+  ASSERT_EQ(50u, c.size());
+  for (auto i = 0ul; i < 50; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(50u, stats.hits);
+  for (auto i = 50ul; i < 2000; ++i)
+  {
+    c(operation(i));
+  }
+  ASSERT_EQ(c.statistics().capacity, c.size());
+
+  // Shrinking discards entries.
+  c.resize(100);
+  ASSERT_EQ(initial_capacity, c.statistics().capacity);
+  ASSERT_EQ(2u, stats.resizes);
+  ASSERT_EQ(0u, c.size());
+  for (auto i = 0ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(initial_capacity, c.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, resize_clock)
+{
+  basic_cache<clock_cache_conf, context, operation> c(cxt, 100);
+  for (auto i = 0ul; i < 50; ++i)
+  {
+    c(operation(i));
+  }
+  c.resize(1000);
+  const auto capacity = c.statistics().capacity;
+  for (auto i = 0ul; i < 2 * capacity; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+    ASSERT_EQ(1u, c(operation(0)));
+  }
+  ASSERT_EQ(capacity, c.size());
+  ASSERT_NE(nullptr, c.find(operation(0)));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, adaptive_growth)
+{
+  cache_budget budget{1ul << 30};
+  {
+    cache<context, operation> c(cxt, 100, budget);
+    const auto& stats = c.statistics();
+    ASSERT_LT(0u, budget.used());
+
+    // The more operations among 1000 are kept, the more hits.
+    std::mt19937 gen;
+    std::uniform_int_distribution<std::size_t> dist(0, 999);
+    for (auto n = 0ul; n < 100000; ++n)
+    {
+      const auto i = dist(gen);
+      ASSERT_EQ(i + 1, c(operation(i)));
+    }
+    ASSERT_LE(1000u, c.statistics().capacity);
+    ASSERT_LT(0.8, c.statistics().hit_ratio);
+    ASSERT_LT(0u, stats.resizes);
+  }
+  ASSERT_EQ(0u, budget.used());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct nested_operation;
+basic_cache<cache_conf, context, nested_operation>* nested_cache = nullptr;
+
+/// @brief Sum of i, i/2, i/4, ..., 1, computed by nested operations of the same cache.
+struct nested_operation
+{
+  const std::size_t i_;
+
+  std::size_t
+  operator()(context&)
+  const;
+
+  bool
+  operator==(const nested_operation& op)
+  const noexcept
+  {
+    return i_ == op.i_;
+  }
+};
+
+namespace std {
+
+template <>
+struct hash<nested_operation>
+{
+  std::size_t
+  operator()(const nested_operation& op)
+  const noexcept
+  {
+    return std::hash<std::size_t>()(op.i_);
+  }
+};
+
+} // namespace std
+
+std::size_t
+nested_operation::operator()(context&)
+const
+{
+  return i_ <= 1 ? i_ : i_ + (*nested_cache)(nested_operation{i_ / 2});
+}
+
+std::size_t
+nested_sum(std::size_t i)
+{
+  return i <= 1 ? i : i + nested_sum(i / 2);
+}
+
+TEST(cache, adaptive_nested_operations)
+{
+  cache_budget budget{1ul << 30};
+  basic_cache<cache_conf, context, nested_operation> c(cxt, 100, budget);
+  nested_cache = &c;
+
+  // Resizing while an operation is evaluated would invalidate the lookups in progress.
+  std::mt19937 gen;
+  std::uniform_int_distribution<std::size_t> dist(0, 1ul << 20);
+  for (auto n = 0ul; n < 100000; ++n)
+  {
+    const auto i = dist(gen);
+    ASSERT_EQ(nested_sum(i), c(nested_operation{i}));
+  }
+  ASSERT_LT(0u, c.statistics().resizes);
+  nested_cache = nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, adaptive_no_gain)
+{
+  cache_budget budget{1ul << 30};
+  cache<context, operation> c(cxt, 100, budget);
+  const auto initial_capacity = c.statistics().capacity;
+
+  // Operations never reused: growing is useless.
+  for (auto i = 10000ul; i < 110000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(initial_capacity, c.statistics().capacity);
+  // It has grown once, then shrunk back, and doesn't try again.
+  ASSERT_EQ(2u, c.statistics().resizes);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(cache, adaptive_shared_budget)
+{
+  cache_budget budget{1ul << 30};
+  cache<context, operation> c1(cxt, 100, budget);
+  cache<context, operation> c2(cxt, 100, budget);
+  const auto initial_capacity = c1.statistics().capacity;
+  const auto initial_used = budget.used();
+
+  // Both caches want to grow, but the budget only has room for a few growths.
+  budget.set_limit(initial_used * 8);
+  std::mt19937 gen;
+  std::uniform_int_distribution<std::size_t> dist(0, 4999);
+  for (auto n = 0ul; n < 200000; ++n)
+  {
+    c1(operation(dist(gen)));
+    c2(operation(dist(gen)));
+  }
+  ASSERT_LE(budget.used(), budget.limit());
+  // At least one cache has grown.
+  ASSERT_LT(2 * initial_capacity, c1.statistics().capacity + c2.statistics().capacity);
+
+  // Under memory pressure, caches shrink back to their initial size.
+  budget.set_limit(0);
+  for (auto i = 0ul; i < 20000; ++i)
+  {
+    c1(operation(10000 + i));
+    c2(operation(10000 + i));
+  }
+  ASSERT_EQ(initial_capacity, c1.statistics().capacity);
+  ASSERT_EQ(initial_capacity, c2.statistics().capacity);
+  ASSERT_EQ(initial_used, budget.used());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Operations i and j are in the same set of a direct cache with n sets if i = j mod n.
+struct identity_direct_cache_conf
+  : public direct_cache_conf
+{
+  using hash_policy = identity_mixer;
+};
+
+struct identity_two_way_cache_conf
+  : public identity_direct_cache_conf
+{
+  static constexpr std::size_t ways = 2;
+};
+
+TEST(direct_cache, direct_mapped)
+{
+  basic_direct_cache<identity_direct_cache_conf, context, operation> c(cxt, 4);
+  const auto& stats = c.statistics();
+
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(3u, c(operation(2)));
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(2u, stats.misses);
+  ASSERT_EQ(2u, c.size());
+
+  // 5 overwrites 1.
+  ASSERT_EQ(6u, c(operation(5)));
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(3u, stats.misses);
+  ASSERT_EQ(1u, stats.discarded);
+  ASSERT_EQ(2u, c.size());
+  ASSERT_EQ(nullptr, c.find(operation(1)));
+  ASSERT_NE(nullptr, c.find(operation(5)));
+  ASSERT_EQ(6u, *c.find(operation(5)));
+  ASSERT_EQ(3u, stats.hits);
+
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(4u, stats.misses);
+  ASSERT_EQ(2u, stats.discarded);
+
+  c.clear();
+  ASSERT_EQ(0u, c.size());
+  ASSERT_EQ(nullptr, c.find(operation(1)));
+}
+
+TEST(direct_cache, two_way)
+{
+  // 2 sets of 2 entries.
+  basic_direct_cache<identity_two_way_cache_conf, context, operation> c(cxt, 4);
+  const auto& stats = c.statistics();
+
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(4u, c(operation(3)));
+  ASSERT_EQ(2u, c.size());
+  ASSERT_EQ(0u, stats.discarded);
+
+  // 1 is more recently used than 3, 5 overwrites 3.
+  ASSERT_EQ(2u, c(operation(1)));
+  ASSERT_EQ(6u, c(operation(5)));
+  ASSERT_EQ(1u, stats.discarded);
+  ASSERT_NE(nullptr, c.find(operation(1)));
+  ASSERT_EQ(nullptr, c.find(operation(3)));
+
+  // 1 has just been found, 7 overwrites 5.
+  ASSERT_EQ(8u, c(operation(7)));
+  ASSERT_NE(nullptr, c.find(operation(1)));
+  ASSERT_EQ(nullptr, c.find(operation(5)));
+  ASSERT_EQ(2u, c.size());
+  ASSERT_EQ(4u, c.statistics().buckets);
+}
+
+TEST(direct_cache, filters_and_exception)
+{
+  direct_cache<context, operation, filter_0, filter_6666> c(cxt, 100);
+  const auto& stats = c.statistics();
+
+  ASSERT_EQ(1u, c(operation(0)));
+  ASSERT_EQ(1u, c(operation(0)));
+  ASSERT_EQ(2u, stats.filtered);
+  ASSERT_EQ(0u, c.size());
+  ASSERT_THROW(c(operation(6666)), std::runtime_error);
+  ASSERT_EQ(0u, c.size());
+
+  for (auto i = 1ul; i < 1000; ++i)
+  {
+    ASSERT_EQ(i + 1, c(operation(i)));
+  }
+  ASSERT_EQ(999u, stats.misses + stats.hits);
+  ASSERT_EQ(999u - stats.discarded, c.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,3 +1,6 @@
+#include <set>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "coredd/ptr.hh"
@@ -20,10 +23,10 @@ struct unique
     ++ref_counter_;
   }
 
-  void
+  bool
   decrement_reference_counter()
   {
-    --ref_counter_;
+    return --ref_counter_ == 0;
   }
 
   bool
@@ -41,12 +44,11 @@ struct unique
   }
 };
 
-template <>
-struct unique_table<unique>
+struct table
 {
   std::size_t nb_deletions_;
 
-  unique_table()
+  table()
     : nb_deletions_(0)
   {}
 
@@ -80,7 +82,7 @@ struct ptr_test
 {
   using ptr_type = ptr<unique>;
 
-  coredd::unique_table<unique> table_;
+  coredd::table table_;
 
   ptr_test()
     : table_()
@@ -206,3 +208,54 @@ TEST_F(ptr_test, object_life)
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_F(ptr_test, borrow)
+{
+  unique u(42);
+  {
+    const ptr_type a(&table_(u));
+    const ptr_ref<unique> r = a;
+    ASSERT_EQ(1u, u.ref_counter_);
+    ASSERT_EQ(42, r->data());
+    ASSERT_TRUE(r == a);
+    ASSERT_TRUE(a == r);
+    ASSERT_EQ(std::hash<ptr_type>()(a), std::hash<ptr_ref<unique>>()(r));
+    {
+      const ptr_ref<unique> copy = r;
+      ASSERT_EQ(1u, u.ref_counter_);
+      const ptr_type b{copy};
+      ASSERT_EQ(2u, u.ref_counter_);
+      ASSERT_EQ(a, b);
+    }
+    ASSERT_EQ(1u, u.ref_counter_);
+    ASSERT_EQ(0u, table_.nb_deletions_);
+  }
+  ASSERT_EQ(1u, table_.nb_deletions_);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_F(ptr_test, hash)
+{
+  // Data are aligned, thus the low bits of their addresses are always the same.
+  std::vector<unique> uniques;
+  uniques.reserve(256);
+  for (int i = 0; i < 256; ++i)
+  {
+    uniques.emplace_back(i);
+  }
+  std::set<std::size_t> low_bits;
+  {
+    std::vector<ptr_type> ptrs;
+    for (auto& u : uniques)
+    {
+      ptrs.emplace_back(&table_(u));
+      low_bits.insert(std::hash<ptr_type>()(ptrs.back()) & 15);
+    }
+    const ptr_type other{&table_(uniques[0])};
+    ASSERT_EQ(std::hash<ptr_type>()(ptrs.front()), std::hash<ptr_type>()(other));
+  }
+  ASSERT_EQ(16u, low_bits.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,530 @@
+#include <iostream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coredd/unicity.hh"
+
+using namespace coredd;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, make)
+{
+  auto u = unicity<int, char>{16};
+  {
+    const auto i1 = u.make<int>(42);
+    const auto i2 = u.make<int>(42);
+    const auto c = u.make<char>('a');
+    ASSERT_EQ(i1, i2);
+    ASSERT_TRUE(i1.is<int>());
+    ASSERT_TRUE(c.is<char>());
+    ASSERT_EQ(42, i1.get<int>());
+    const unicity<int, char>::ptr_ref_type r = i1;
+    ASSERT_TRUE(r.is<int>());
+    ASSERT_EQ(42, r.get<int>());
+    ASSERT_EQ(2u, u.unique_table_stats().size);
+  }
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, concurrent_make)
+{
+  using unicity_type = basic_unicity<concurrent_unicity_conf, int>;
+  auto u = unicity_type{1024};
+
+  const auto nb_threads = 4u;
+  const auto nb_values = 10000;
+  std::vector<std::vector<unicity_type::ptr_type>> results(nb_threads);
+
+  std::vector<std::thread> threads;
+  for (auto t = 0u; t < nb_threads; ++t)
+  {
+    threads.emplace_back([&, t]
+    {
+      auto& res = results[t];
+      res.reserve(nb_values);
+      for (int round = 0; round < 10; ++round)
+      {
+        // Unified data are created and released concurrently.
+        res.clear();
+        for (int i = 0; i < nb_values; ++i)
+        {
+          res.push_back(u.make<int>(i));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(static_cast<std::size_t>(nb_values), u.unique_table_stats().size);
+  for (auto t = 1u; t < nb_threads; ++t)
+  {
+    for (auto i = 0; i < nb_values; ++i)
+    {
+      ASSERT_EQ(results[0][i], results[t][i]);
+    }
+  }
+  results.clear();
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, shared_between_threads)
+{
+  using unicity_type = basic_unicity<biased_concurrent_unicity_conf, int>;
+  auto u = unicity_type{1024};
+
+  const auto nb_values = 1000;
+  std::vector<unicity_type::ptr_type> values;
+  for (int i = 0; i < nb_values; ++i)
+  {
+    values.push_back(u.make<int>(i));
+  }
+
+  std::vector<std::thread> threads;
+  for (auto t = 0u; t < 4; ++t)
+  {
+    threads.emplace_back([&]
+    {
+      for (int round = 0; round < 10; ++round)
+      {
+        // Copy and release data created by another thread, or unify them again.
+        std::vector<unicity_type::ptr_type> copies{values};
+        for (int i = 0; i < nb_values; ++i)
+        {
+          copies.push_back(u.make<int>(i));
+          copies.push_back(u.make<int>(nb_values + i));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(static_cast<std::size_t>(nb_values), u.unique_table_stats().size);
+  values.clear();
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, immortal)
+{
+  auto u = unicity<int>{16};
+  {
+    const auto i = u.make_immortal(u.make<int>(42));
+    ASSERT_TRUE(i->is_immortal());
+    ASSERT_FALSE(u.make<int>(33)->is_immortal());
+  }
+  // Only the immortal data is still there.
+  ASSERT_EQ(1u, u.unique_table_stats().size);
+  {
+    const auto i = u.make<int>(42);
+    ASSERT_TRUE(i->is_immortal());
+    auto copies = std::vector<unicity<int>::ptr_type>(100, i);
+  }
+  ASSERT_EQ(1u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, concurrent_immortal)
+{
+  using unicity_type = basic_unicity<biased_concurrent_unicity_conf, int>;
+  auto u = unicity_type{1024};
+  const auto zero = u.make_immortal(u.make<int>(0));
+
+  std::vector<std::thread> threads;
+  for (auto t = 0u; t < 4; ++t)
+  {
+    threads.emplace_back([&]
+    {
+      for (int i = 0; i < 10000; ++i)
+      {
+        auto copy = zero;
+        ASSERT_EQ(zero, u.make<int>(0));
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  ASSERT_EQ(1u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+/// @brief A data which counts its destructions.
+struct destroyed
+{
+  static unsigned int nb_destructions;
+
+  int i;
+
+  explicit destroyed(int i_)
+    : i{i_}
+  {}
+
+  ~destroyed()
+  {
+    ++nb_destructions;
+  }
+
+  bool
+  operator==(const destroyed& other)
+  const noexcept
+  {
+    return i == other.i;
+  }
+
+  friend
+  std::ostream&
+  operator<<(std::ostream& os, const destroyed& x)
+  {
+    return os << x.i;
+  }
+};
+
+unsigned int destroyed::nb_destructions = 0;
+
+} // namespace anonymous
+
+namespace std {
+
+template <>
+struct hash<destroyed>
+{
+  std::size_t
+  operator()(const destroyed& x)
+  const noexcept
+  {
+    return std::hash<int>()(x.i);
+  }
+};
+
+} // namespace std
+
+TEST(unicity, immortal_destruction)
+{
+  destroyed::nb_destructions = 0;
+  {
+    auto u = unicity<destroyed>{16};
+    u.make_immortal(u.make<destroyed>(0));
+    u.make_immortal(u.make<destroyed>(1));
+    ASSERT_EQ(0u, destroyed::nb_destructions);
+  }
+  // Immortal data are destroyed with the unicity.
+  ASSERT_EQ(2u, destroyed::nb_destructions);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, multiple_instances)
+{
+  using unicity_type = basic_unicity<multiple_unicity_conf, int>;
+  auto u1 = std::make_unique<unicity_type>(16);
+  auto u2 = unicity_type{16};
+  {
+    const auto i1 = u1->make<int>(42);
+    const auto i2 = u2.make<int>(42);
+    // Each unicity has its own data.
+    ASSERT_FALSE(i1 == i2);
+    ASSERT_EQ(i1, u1->make<int>(42));
+    ASSERT_EQ(i2, u2.make<int>(42));
+    u2.make<int>(43);
+    ASSERT_EQ(1u, u1->unique_table_stats().size);
+    ASSERT_EQ(1u, u2.unique_table_stats().size);
+  }
+  // Data have been given back to their own unicity.
+  ASSERT_EQ(0u, u1->unique_table_stats().size);
+  ASSERT_EQ(0u, u2.unique_table_stats().size);
+  {
+    const auto i2 = u2.make<int>(42);
+    // A unicity can be destroyed while another one is still used.
+    u1.reset();
+  }
+  ASSERT_EQ(0u, u2.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, compact)
+{
+  auto u = unicity<int>{16};
+  {
+    std::vector<unicity<int>::ptr_type> vec;
+    for (int i = 0; i < 1000; ++i)
+    {
+      vec.push_back(u.make<int>(i));
+    }
+    vec.erase(vec.begin() + 5, vec.end());
+    ASSERT_LT(16u, u.unique_table_stats().buckets);
+    ASSERT_TRUE(u.compact());
+    ASSERT_EQ(1u, u.unique_table_stats().shrink);
+    ASSERT_EQ(16u, u.unique_table_stats().buckets);
+    for (int i = 0; i < 5; ++i)
+    {
+      ASSERT_EQ(vec[i], u.make<int>(i));
+    }
+  }
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unicity, sampled_stats)
+{
+  auto u = unicity<int>{16};
+  std::vector<unicity<int>::ptr_type> vec;
+  for (int i = 0; i < 1000; ++i)
+  {
+    vec.push_back(u.make<int>(i));
+  }
+  ASSERT_EQ(0u, u.unique_table_stats().longest_chain);
+  ASSERT_LE(1u, u.unique_table_stats(~0ul).longest_chain);
+  ASSERT_LE(1u, u.unique_table_stats(64).longest_chain);
+  // Sampling is not sticky.
+  ASSERT_EQ(0u, u.unique_table_stats().longest_chain);
+
+  auto cu = basic_unicity<concurrent_unicity_conf, int>{1024};
+  std::vector<basic_unicity<concurrent_unicity_conf, int>::ptr_type> cvec;
+  for (int i = 0; i < 1000; ++i)
+  {
+    cvec.push_back(cu.make<int>(i));
+  }
+  ASSERT_EQ(0u, cu.unique_table_stats().longest_chain);
+  ASSERT_LE(1u, cu.unique_table_stats(~0ul).longest_chain);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct small_deferred_unicity_conf
+  : public unicity_conf
+{
+  static constexpr std::size_t dead_threshold = 4;
+};
+
+} // namespace anonymous
+
+TEST(unicity, deferred_reclamation)
+{
+  auto u = basic_unicity<small_deferred_unicity_conf, int>{16};
+  const void* addr = nullptr;
+  {
+    const auto i0 = u.make<int>(0);
+    addr = i0.operator->();
+    u.make<int>(1);
+    u.make<int>(2);
+  }
+  // Released data are still there.
+  ASSERT_EQ(3u, u.unique_table_stats().size);
+  ASSERT_EQ(3u, u.unique_table_stats().dead);
+  ASSERT_EQ(4u, u.unique_table_stats().dead_threshold);
+  {
+    // A dead data is revived.
+    const auto i0 = u.make<int>(0);
+    ASSERT_EQ(addr, i0.operator->());
+    ASSERT_EQ(2u, u.unique_table_stats().dead);
+    ASSERT_EQ(1u, u.unique_table_stats().resurrections);
+    ASSERT_DOUBLE_EQ(1. / 3., u.unique_table_stats().resurrection_rate);
+
+    // Reach the threshold: all dead data are reclaimed, but not the referenced one.
+    u.make<int>(3);
+    ASSERT_EQ(3u, u.unique_table_stats().dead);
+    u.make<int>(4);
+    ASSERT_EQ(0u, u.unique_table_stats().dead);
+    ASSERT_EQ(1u, u.unique_table_stats().collections);
+    ASSERT_EQ(1u, u.unique_table_stats().size);
+    ASSERT_EQ(0, i0.get<int>());
+  }
+  ASSERT_EQ(1u, u.unique_table_stats().dead);
+  // Dead data are reclaimed before shrinking.
+  u.compact();
+  ASSERT_EQ(0u, u.unique_table_stats().dead);
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+  ASSERT_EQ(2u, u.unique_table_stats().collections);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+struct chain;
+using chain_unicity = basic_unicity<unicity_conf, int, chain>;
+
+/// @brief A data which references another one.
+struct chain
+{
+  ptr<detail::unique<detail::variant<int, chain>, unicity_conf>> next;
+
+  explicit chain(const ptr<detail::unique<detail::variant<int, chain>, unicity_conf>>& n)
+    : next{n}
+  {}
+
+  bool
+  operator==(const chain& other)
+  const noexcept
+  {
+    return next == other.next;
+  }
+
+  friend
+  std::ostream&
+  operator<<(std::ostream& os, const chain&)
+  {
+    return os << "chain";
+  }
+};
+
+} // namespace anonymous
+
+namespace std {
+
+template <>
+struct hash<chain>
+{
+  std::size_t
+  operator()(const chain& x)
+  const noexcept
+  {
+    return std::hash<coredd::ptr<coredd::detail::unique< coredd::detail::variant<int, chain>
+                                                       , coredd::unicity_conf>>>()(x.next);
+  }
+};
+
+} // namespace std
+
+TEST(unicity, deep_destruction)
+{
+  auto u = chain_unicity{1024};
+  {
+    // Destroying the head of this chain would overflow the stack if the data were destroyed
+    // recursively.
+    auto head = u.make<int>(0);
+    for (auto i = 0; i < 100000; ++i)
+    {
+      head = u.make<chain>(head);
+    }
+    ASSERT_EQ(100001u, u.unique_table_stats().size);
+  }
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* anonymous */ {
+
+/// @brief A data which counts its constructions.
+struct counted
+{
+  static unsigned int nb_constructions;
+
+  int a;
+  int b;
+
+  counted(int a_, int b_)
+    : a{a_}, b{b_}
+  {
+    ++nb_constructions;
+  }
+
+  bool
+  operator==(const counted& other)
+  const noexcept
+  {
+    return a == other.a and b == other.b;
+  }
+
+  friend
+  std::ostream&
+  operator<<(std::ostream& os, const counted& x)
+  {
+    return os << x.a << ',' << x.b;
+  }
+};
+
+unsigned int counted::nb_constructions = 0;
+
+} // namespace anonymous
+
+namespace std {
+
+template <>
+struct hash<counted>
+{
+  std::size_t
+  operator()(const counted& x)
+  const noexcept
+  {
+    using namespace coredd;
+    return seed(x.a) (val(x.b));
+  }
+};
+
+} // namespace std
+
+namespace coredd {
+
+template <>
+struct lookup<counted>
+{
+  static
+  std::size_t
+  hash(int a, int b)
+  noexcept
+  {
+    return seed(a) (val(b));
+  }
+
+  static
+  bool
+  equal(const counted& x, int a, int b)
+  noexcept
+  {
+    return x.a == a and x.b == b;
+  }
+};
+
+} // namespace coredd
+
+TEST(unicity, lookup_before_construction)
+{
+  auto u = unicity<int, counted>{16};
+  {
+    counted::nb_constructions = 0;
+    const auto c1 = u.make<counted>(1, 2);
+    const auto c2 = u.make<counted>(1, 2);
+    const auto c3 = u.make<counted>(2, 1);
+    ASSERT_EQ(c1, c2);
+    ASSERT_FALSE(c1 == c3);
+    // The second data has been found from the constructor arguments.
+    ASSERT_EQ(2u, counted::nb_constructions);
+    ASSERT_EQ(1u, u.unique_table_stats().hits);
+    ASSERT_EQ(2u, u.unique_table_stats().misses);
+    ASSERT_EQ(3u, u.unique_table_stats().access);
+
+    // A copy of an existing data is looked up by default.
+    const auto i1 = u.make<int>(1);
+    ASSERT_EQ(i1, u.make<int>(1));
+    ASSERT_EQ(2u, u.unique_table_stats().hits);
+  }
+  ASSERT_EQ(0u, u.unique_table_stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
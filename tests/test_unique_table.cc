@@ -1,7 +1,10 @@
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "coredd/detail/hash_table.hh"
-#include "coredd/unique_table.hh"
+#include "coredd/detail/unique.hh"
+#include "coredd/detail/unique_table.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -9,11 +12,18 @@ namespace {
 
 struct foo
 {
-  coredd::detail::intrusive_member_hook<foo> hook;
+  coredd::detail::intrusive_member_hook<foo> m_hook;
   int i_;
 
   foo(int i) : i_(i) {}
 
+  coredd::detail::intrusive_member_hook<foo>&
+  hook()
+  noexcept
+  {
+    return m_hook;
+  }
+
   bool
   operator==(const foo& other)
   const noexcept
@@ -35,6 +45,14 @@ struct foo
   {
     return true;
   }
+
+  // Needed by the destructor of unique_table.
+  bool
+  is_immortal()
+  const noexcept
+  {
+    return false;
+  }
 };
 
 }
@@ -59,7 +77,7 @@ struct hash<foo>
 TEST(unique_table_test, insertion)
 {
   {
-    coredd::unique_table<foo> ut(100);
+    coredd::detail::unique_table<foo> ut(100);
 
     char* addr1 = ut.allocate(0);
     foo* i1_ptr = new (addr1) foo(42);
@@ -73,7 +91,7 @@ TEST(unique_table_test, insertion)
     ut.erase(&i1);
   }
   {
-    coredd::unique_table<foo> ut(100);
+    coredd::detail::unique_table<foo> ut(100);
 
     char* addr1 = ut.allocate(0);
     foo* i1_ptr = new (addr1) foo(42);
@@ -93,3 +111,192 @@ TEST(unique_table_test, insertion)
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST(unique_table_test, flat_backend)
+{
+  coredd::detail::unique_table<foo, coredd::flat_unicity_conf> ut(16);
+
+  std::vector<const foo*> foos;
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    foos.push_back(&ut(new (addr) foo(i), 0));
+  }
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    ASSERT_EQ(foos[i], &ut(new (addr) foo(i), 0));
+  }
+  ASSERT_EQ(1000u, ut.stats().size);
+  ASSERT_EQ(1000u, ut.stats().hits);
+  for (auto f : foos)
+  {
+    ut.erase(f);
+  }
+  ASSERT_EQ(0u, ut.stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unique_table_test, slab_allocator)
+{
+  coredd::detail::unique_table<foo, coredd::slab_unicity_conf> ut(16);
+
+  std::vector<const foo*> foos;
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    foos.push_back(&ut(new (addr) foo(i), 0));
+  }
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    ASSERT_EQ(foos[i], &ut(new (addr) foo(i), 0));
+  }
+  ASSERT_LE(1000 * sizeof(foo), ut.stats().memory.used);
+  for (auto f : foos)
+  {
+    ut.erase(f);
+  }
+  ASSERT_EQ(0u, ut.stats().size);
+  ASSERT_LT(0u, ut.stats().memory.wasted);
+  ut.compact();
+  ASSERT_EQ(0u, ut.stats().memory.used);
+  ASSERT_EQ(0u, ut.stats().memory.wasted);
+  ASSERT_LT(0u, ut.stats().memory.returned);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct hashed_unicity_conf
+  : public coredd::unicity_conf
+{
+  static constexpr bool store_hash = true;
+};
+
+TEST(unique_table_test, stored_hash)
+{
+  using unique_type = coredd::detail::unique<int, hashed_unicity_conf>;
+  static_assert(coredd::detail::stores_hash<unique_type>::value, "");
+
+  coredd::detail::unique_table<unique_type, hashed_unicity_conf> ut(16);
+  std::vector<const unique_type*> uniques;
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    uniques.push_back(&ut(new (addr) unique_type(i), 0));
+    // The stored hash value has been mixed by the hash policy.
+    const auto hash = hashed_unicity_conf::hash_policy{}(std::hash<int>()(i));
+    ASSERT_EQ( static_cast<decltype(uniques.back()->hook().hash)>(hash)
+             , uniques.back()->hook().hash);
+  }
+  for (int i = 0; i < 1000; ++i)
+  {
+    char* addr = ut.allocate(0);
+    ASSERT_EQ(uniques[i], &ut(new (addr) unique_type(i), 0));
+  }
+  for (auto u : uniques)
+  {
+    ut.erase(u);
+  }
+  ASSERT_EQ(0u, ut.stats().size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct counting_reference_counter
+  : public coredd::detail::plain_reference_counter
+{
+  static std::size_t nb_checks;
+
+  bool
+  is_zero()
+  const noexcept
+  {
+    ++nb_checks;
+    return plain_reference_counter::is_zero();
+  }
+};
+
+std::size_t counting_reference_counter::nb_checks = 0;
+
+struct counting_deferred_unicity_conf
+  : public coredd::unicity_conf
+{
+  static constexpr std::size_t dead_threshold = 8;
+  using reference_counter = counting_reference_counter;
+};
+
+using counting_unique = coredd::detail::unique<int, counting_deferred_unicity_conf>;
+using counting_unique_table
+  = coredd::detail::unique_table<counting_unique, counting_deferred_unicity_conf>;
+
+TEST(unique_table_test, collection_cost)
+{
+  // The number of data inspected by a collection.
+  const auto collection_cost = [](int nb_live)
+  {
+    counting_unique_table ut(16);
+    std::vector<counting_unique*> live;
+    for (int i = 0; i < nb_live; ++i)
+    {
+      auto& u = ut(new (ut.allocate(0)) counting_unique(i), 0);
+      u.increment_reference_counter();
+      live.push_back(&u);
+    }
+    for (int i = 1; i < 8; ++i)
+    {
+      ut.erase(&ut(new (ut.allocate(0)) counting_unique(-i), 0));
+    }
+    EXPECT_EQ(7u, ut.stats().dead);
+    counting_reference_counter::nb_checks = 0;
+    ut.erase(&ut(new (ut.allocate(0)) counting_unique(-8), 0));
+    const auto cost = counting_reference_counter::nb_checks;
+    EXPECT_EQ(0u, ut.stats().dead);
+    EXPECT_EQ(1u, ut.stats().collections);
+    EXPECT_EQ(static_cast<std::size_t>(nb_live), ut.stats().size);
+    for (auto u : live)
+    {
+      u->decrement_reference_counter();
+      ut.erase(u);
+    }
+    return cost;
+  };
+  ASSERT_EQ(collection_cost(10), collection_cost(10000));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST(unique_table_test, revive_dead)
+{
+  counting_unique_table ut(16);
+  std::vector<const counting_unique*> dead;
+  for (int i = 0; i < 3; ++i)
+  {
+    dead.push_back(&ut(new (ut.allocate(0)) counting_unique(i), 0));
+    ut.erase(dead.back());
+  }
+  ASSERT_EQ(3u, ut.stats().dead);
+
+  // Unified again: it's no longer dead.
+  auto& revived = ut(new (ut.allocate(0)) counting_unique(1), 0);
+  ASSERT_EQ(dead[1], &revived);
+  revived.increment_reference_counter();
+  ASSERT_EQ(2u, ut.stats().dead);
+  ASSERT_EQ(1u, ut.stats().resurrections);
+
+  // Collect dead data, but not the revived one.
+  for (int i = 3; i < 9; ++i)
+  {
+    ut.erase(&ut(new (ut.allocate(0)) counting_unique(i), 0));
+  }
+  ASSERT_EQ(1u, ut.stats().collections);
+  ASSERT_EQ(0u, ut.stats().dead);
+  ASSERT_EQ(1u, ut.stats().size);
+  ASSERT_EQ(&revived, &ut(new (ut.allocate(0)) counting_unique(1), 0));
+
+  revived.decrement_reference_counter();
+  ut.erase(&revived);
+}
+
+/*------------------------------------------------------------------------------------------------*/
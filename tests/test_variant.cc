@@ -1,8 +1,8 @@
 #include "gtest/gtest.h"
 
-#include "coredd/variant.hh"
+#include "coredd/detail/variant.hh"
 
-using namespace coredd;
+using namespace coredd::detail;
 
 /*------------------------------------------------------------------------------------------------*/
 